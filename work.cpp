@@ -1,12 +1,41 @@
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <cctype>
 #include <vector>
+#include <array>
 #include <string>
 #include <optional>
 #include <algorithm>
 #include <iomanip>
 #include <chrono>
 #include <filesystem>
+#include <unordered_map>
+#include <map>
+#include <set>
+#include <unordered_set>
+#include <thread>
+#include <atomic>
+#include <string_view>
+#include <cstring>
+#include <cmath>
+#include <cstdint>
+#include <cerrno>
+#include <charconv>
+#include <memory>
+#include <memory_resource>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include <csignal>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
 #include <nlohmann/json.hpp>
 #include <cxxopts.hpp>
 #include <date/date.h>
@@ -30,20 +59,209 @@ std::string priority_to_string(Priority p) {
     }
 }
 
+// Days since 1970-01-01 for a proleptic Gregorian date (Hinnant's days_from_civil)
+constexpr int64_t days_from_civil(int64_t y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+constexpr unsigned days_in_month(int64_t y, unsigned m) {
+    constexpr unsigned char lengths[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    const bool leap = (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+    return (m == 2 && leap) ? 29 : lengths[m - 1];
+}
+
+// True when every byte of s[0, len) at a position flagged in digit_bits is '0'..'9'
+inline bool digits_at(const char* s, size_t len, uint32_t digit_bits) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    if (len >= 16) {
+        // Bytes >= 0x80 compare as negative, so they fail the '0' bound as well
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+        const __m128i ok = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)),
+                                         _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+        const uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(ok));
+        if ((mask & digit_bits & 0xFFFF) != (digit_bits & 0xFFFF)) {
+            return false;
+        }
+        i = 16;
+    }
+#endif
+    for (; i < len; i++) {
+        if ((digit_bits >> i) & 1) {
+            if (static_cast<unsigned char>(s[i] - '0') > 9) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+inline unsigned two_digits(const char* p) {
+    return static_cast<unsigned>(p[0] - '0') * 10 + static_cast<unsigned>(p[1] - '0');
+}
+
+// Allocation-free parser for the fixed "YYYY-MM-DD" / "YYYY-MM-DD HH:MM:SS"
+// layouts. Returns false on anything irregular so callers can fall back to
+// date::parse.
+inline bool parse_fixed_timestamp(std::string_view s, bool with_time, int64_t& epoch_seconds) {
+    constexpr uint32_t kDateDigits = 0b1101101111;                       // YYYY-MM-DD
+    constexpr uint32_t kDateTimeDigits = kDateDigits | (0b110110110u << 10);  // " HH:MM:SS"
+    const size_t len = with_time ? 19 : 10;
+    if (s.size() != len || s[4] != '-' || s[7] != '-' ||
+        (with_time && (s[10] != ' ' || s[13] != ':' || s[16] != ':')) ||
+        !digits_at(s.data(), len, with_time ? kDateTimeDigits : kDateDigits)) {
+        return false;
+    }
+
+    const int64_t year = two_digits(s.data()) * 100 + two_digits(s.data() + 2);
+    const unsigned month = two_digits(s.data() + 5);
+    const unsigned day = two_digits(s.data() + 8);
+    if (month < 1 || month > 12 || day < 1 || day > days_in_month(year, month)) {
+        return false;
+    }
+
+    int64_t secs = days_from_civil(year, month, day) * 86400;
+    if (with_time) {
+        const unsigned hour = two_digits(s.data() + 11);
+        const unsigned minute = two_digits(s.data() + 14);
+        const unsigned second = two_digits(s.data() + 17);
+        if (hour > 23 || minute > 59 || second > 59) {
+            return false;
+        }
+        secs += hour * 3600 + minute * 60 + second;
+    }
+    epoch_seconds = secs;
+    return true;
+}
+
+// Fixed timestamp layouts; the value is the rendered length
+enum class TimeLayout { Date = 10, Minutes = 16, Seconds = 19 };
+
+// Formats time points as "YYYY-MM-DD[ HH:MM[:SS]]" straight into a caller
+// buffer. The date prefix is cached per day, since most tasks in a file share
+// a handful of days. Years outside 0000-9999 go through date::format.
+class TimestampFormatter {
+public:
+    static constexpr size_t kMaxLength = 32;
+
+    // Writes the timestamp for epoch seconds secs at out and returns the end
+    // of the written range
+    char* format(int64_t secs, TimeLayout layout, char* out) {
+        const int64_t day = secs >= 0 ? secs / 86400 : (secs - 86399) / 86400;
+        if (day != cached_day && !cache_day(day)) {
+            const char* fmt = layout == TimeLayout::Date ? "%Y-%m-%d"
+                            : layout == TimeLayout::Minutes ? "%Y-%m-%d %H:%M" : "%Y-%m-%d %H:%M:%S";
+            const std::string slow = date::format(fmt, date::sys_seconds(seconds(secs)));
+            const size_t n = std::min(slow.size(), kMaxLength);
+            std::memcpy(out, slow.data(), n);
+            return out + n;
+        }
+
+        std::memcpy(out, prefix, 10);
+        if (layout == TimeLayout::Date) {
+            return out + 10;
+        }
+        const unsigned sod = static_cast<unsigned>(secs - day * 86400);
+        out[10] = ' ';
+        put_two(out + 11, sod / 3600);
+        out[13] = ':';
+        put_two(out + 14, sod / 60 % 60);
+        if (layout == TimeLayout::Minutes) {
+            return out + 16;
+        }
+        out[16] = ':';
+        put_two(out + 17, sod % 60);
+        return out + 19;
+    }
+
+    char* format(system_clock::time_point tp, TimeLayout layout, char* out) {
+        return format(floor<seconds>(tp).time_since_epoch().count(), layout, out);
+    }
+
+    std::string format(int64_t secs, TimeLayout layout) {
+        char buf[kMaxLength];
+        return std::string(buf, format(secs, layout, buf));
+    }
+
+    std::string format(system_clock::time_point tp, TimeLayout layout) {
+        return format(floor<seconds>(tp).time_since_epoch().count(), layout);
+    }
+
+private:
+    int64_t cached_day = INT64_MIN;
+    char prefix[10] = {};
+
+    static void put_two(char* p, unsigned v) {
+        p[0] = static_cast<char>('0' + v / 10);
+        p[1] = static_cast<char>('0' + v % 10);
+    }
+
+    // Hinnant's civil_from_days, rendered once per distinct day
+    bool cache_day(int64_t day) {
+        const int64_t z = day + 719468;
+        const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+        const unsigned doe = static_cast<unsigned>(z - era * 146097);
+        const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+        const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+        const unsigned mp = (5 * doy + 2) / 153;
+        const unsigned d = doy - (153 * mp + 2) / 5 + 1;
+        const unsigned m = mp < 10 ? mp + 3 : mp - 9;
+        const int64_t y = static_cast<int64_t>(yoe) + era * 400 + (m <= 2);
+        if (y < 0 || y > 9999) {
+            return false;
+        }
+        put_two(prefix, static_cast<unsigned>(y / 100));
+        put_two(prefix + 2, static_cast<unsigned>(y % 100));
+        prefix[4] = '-';
+        put_two(prefix + 5, m);
+        prefix[7] = '-';
+        put_two(prefix + 8, d);
+        cached_day = day;
+        return true;
+    }
+};
+
+// Timestamps are held as epoch seconds, the only resolution ever persisted;
+// time_points are converted on the way in
+constexpr int64_t kNoDueDate = INT64_MIN;
+
+inline int64_t to_epoch_seconds(system_clock::time_point tp) {
+    return floor<seconds>(tp).time_since_epoch().count();
+}
+
+class TaskSaxHandler;
+class TaskJsonWriter;
+
 // Task class with priority and category
 class Task {
+    friend class TaskSaxHandler;
+    friend class TaskJsonWriter;
+
 public:
     int id;
     std::string description;
     bool completed;
     Priority priority;
     std::string category;
-    system_clock::time_point created_at;
-    std::optional<system_clock::time_point> due_date;
+    int64_t created_at;              // epoch seconds
+    int64_t due_date = kNoDueDate;   // epoch seconds
+
+    Task() : id(0), completed(false), priority(Priority::Medium), created_at(0) {}
 
     Task(int id, std::string desc, Priority pri = Priority::Medium, std::string cat = "General", bool comp = false)
         : id(id), description(std::move(desc)), completed(comp), priority(pri), category(std::move(cat)),
-          created_at(system_clock::now()) {}
+          created_at(to_epoch_seconds(system_clock::now())) {}
+
+    bool has_due_date() const { return due_date != kNoDueDate; }
+
+    void set_due_time(std::optional<system_clock::time_point> tp) {
+        due_date = tp ? to_epoch_seconds(*tp) : kNoDueDate;
+    }
 
     // JSON serialization
     void to_json(json& j) const {
@@ -54,7 +272,7 @@ public:
             {"priority", priority_to_string(priority)},
             {"category", category},
             {"created_at", format_time(created_at)},
-            {"due_date", due_date ? format_time(*due_date) : nullptr}
+            {"due_date", has_due_date() ? json(format_time(due_date)) : json(nullptr)}
         };
     }
 
@@ -67,305 +285,5163 @@ public:
         category = j.at("category").get<std::string>();
         created_at = parse_time(j.at("created_at").get<std::string>());
         if (j.at("due_date").is_null()) {
-            due_date = std::nullopt;
+            due_date = kNoDueDate;
         } else {
             due_date = parse_time(j.at("due_date").get<std::string>());
         }
     }
 
 private:
-    // Format time point to string
-    static std::string format_time(const system_clock::time_point& tp) {
-        return date::format("%Y-%m-%d %H:%M:%S", tp);
+    // Format epoch seconds to string
+    static std::string format_time(int64_t secs) {
+        thread_local TimestampFormatter formatter;
+        return formatter.format(secs, TimeLayout::Seconds);
     }
 
-    // Parse string to time point
-    static system_clock::time_point parse_time(const std::string& s) {
-        std::istringstream iss(s);
+    // Parse string to epoch seconds
+    static int64_t parse_time(std::string_view s) {
+        int64_t secs;
+        if (parse_fixed_timestamp(s, true, secs)) {
+            return secs;
+        }
+        std::istringstream iss{std::string(s)};
         system_clock::time_point tp;
         iss >> date::parse("%Y-%m-%d %H:%M:%S", tp);
-        return tp;
+        return to_epoch_seconds(tp);
     }
 };
 
-// TaskManager class with enhanced functionality
-class TaskManager {
-public:
-    TaskManager(const std::string& fp) : file_path(fp), next_id(1) {
-        load_tasks();
+// ADL hooks so nlohmann can (de)serialize Task and std::vector<Task> directly
+void to_json(json& j, const Task& t) { t.to_json(j); }
+void from_json(const json& j, Task& t) { t.from_json(j); }
+
+// Read-only view of one task, borrowed from a Task or from a mapped snapshot
+struct TaskView {
+    int id;
+    std::string_view description;
+    bool completed;
+    Priority priority;
+    std::string_view category;
+    int64_t created_at;  // epoch seconds
+    int64_t due_date;    // epoch seconds, kNoDueDate when unset
+
+    bool has_due_date() const { return due_date != kNoDueDate; }
+};
+
+TaskView view_of(const Task& t) {
+    return TaskView{t.id, t.description, t.completed, t.priority, t.category, t.created_at, t.due_date};
+}
+
+TaskView view_of(const TaskView& v) {
+    return v;
+}
+
+
+// Sort order for task listings
+enum class SortBy { Id, Priority, DueDate };
+
+SortBy parse_sort_by(const std::string& s) {
+    if (s == "priority") return SortBy::Priority;
+    if (s == "due_date") return SortBy::DueDate;
+    return SortBy::Id;
+}
+
+// 64-bit sort key for one row; ties are broken by the caller
+inline uint64_t make_sort_key(SortBy by, Priority priority, int64_t due_secs) {
+    switch (by) {
+        case SortBy::Priority:
+            return static_cast<uint64_t>(Priority::High) - static_cast<uint64_t>(priority);
+        case SortBy::DueDate:
+            if (due_secs == kNoDueDate) return UINT64_MAX;
+            // Flip the sign bit so signed epoch seconds order correctly as unsigned
+            return static_cast<uint64_t>(due_secs) ^ (1ull << 63);
+        default:
+            return 0;
     }
+}
 
-    // Add a new task with priority and category
-    void add_task(const std::string& desc, const std::optional<std::string>& due,
-                  Priority pri, const std::string& cat) {
-        std::optional<system_clock::time_point> due_date;
-        if (due) {
-            std::istringstream iss(*due);
-            system_clock::time_point tp;
-            iss >> date::parse("%Y-%m-%d", tp);
-            if (!iss.fail()) {
-                due_date = tp;
-            } else {
-                std::cerr << "Warning: Invalid due date format, ignoring due date.\n";
-            }
-        }
+uint64_t sort_key(const TaskView& t, SortBy by) {
+    return make_sort_key(by, t.priority, t.due_date);
+}
 
-        tasks.emplace_back(next_id, desc, pri, cat);
-        if (due_date) {
-            tasks.back().due_date = due_date;
+// Interned category names. Each distinct name is stored once and tasks refer
+// to it by a small integer id, so filtering and grouping compare integers.
+class CategoryDictionary {
+public:
+    uint32_t intern(std::string_view name) {
+        auto it = ids.find(name);
+        if (it != ids.end()) {
+            return it->second;
         }
-        std::cout << "Task added with ID " << next_id << "\n";
-        next_id++;
-        save_tasks();
+        const auto id = static_cast<uint32_t>(names.size());
+        names.emplace_back(name);
+        ids.emplace(names.back(), id);
+        return id;
     }
 
-    // List tasks with sorting option
-    void list_tasks(const std::string& sort_by) const {
-        if (tasks.empty()) {
-            std::cout << "No tasks found.\n";
-            return;
+    std::optional<uint32_t> find(std::string_view name) const {
+        auto it = ids.find(name);
+        if (it == ids.end()) {
+            return std::nullopt;
         }
+        return it->second;
+    }
 
-        std::vector<Task> sorted_tasks = tasks;
-        if (sort_by == "priority") {
-            std::sort(sorted_tasks.begin(), sorted_tasks.end(),
-                [](const Task& a, const Task& b) {
-                    return static_cast<int>(a.priority) > static_cast<int>(b.priority);
-                });
-        } else if (sort_by == "due_date") {
-            std::sort(sorted_tasks.begin(), sorted_tasks.end(),
-                [](const Task& a, const Task& b) {
-                    if (!a.due_date && !b.due_date) return a.id < b.id;
-                    if (!a.due_date) return false;
-                    if (!b.due_date) return true;
-                    return *a.due_date < *b.due_date;
-                });
-        }
+    std::string_view name(uint32_t id) const { return names[id]; }
+    size_t size() const { return names.size(); }
+
+    void clear() {
+        names.clear();
+        ids.clear();
+    }
+
+private:
+    std::vector<std::string> names;
+    std::map<std::string, uint32_t, std::less<>> ids;  // transparent: lookups by string_view don't allocate
+};
+
+// Compressed bitmap in the Roaring layout: values are split by their high
+// 16 bits into containers, each either a sorted array of low halves (while
+// sparse) or a 1024-word bitmap (once it holds more than kArrayMax values).
+// Set operations go container by container; bitmap-bitmap pairs run through
+// SIMD word kernels.
+class RoaringBitmap {
+public:
+    void add(uint32_t x) {
+        container_for(static_cast<uint16_t>(x >> 16)).add(static_cast<uint16_t>(x));
+    }
+
+    void remove(uint32_t x) {
+        auto it = find(static_cast<uint16_t>(x >> 16));
+        if (it == containers.end()) return;
+        it->remove(static_cast<uint16_t>(x));
+        if (it->cardinality == 0) containers.erase(it);
+    }
+
+    bool contains(uint32_t x) const {
+        auto it = std::lower_bound(containers.begin(), containers.end(), static_cast<uint16_t>(x >> 16),
+            [](const Container& c, uint16_t key) { return c.key < key; });
+        return it != containers.end() && it->key == (x >> 16) && it->contains(static_cast<uint16_t>(x));
+    }
+
+    uint64_t cardinality() const {
+        uint64_t total = 0;
+        for (const auto& c : containers) total += c.cardinality;
+        return total;
+    }
 
-        std::cout << "\nTasks:\n";
-        std::cout << std::left << std::setw(5) << "ID"
-                  << std::setw(30) << "Description"
-                  << std::setw(10) << "Status"
-                  << std::setw(10) << "Priority"
-                  << std::setw(15) << "Category"
-                  << std::setw(20) << "Created At"
-                  << std::setw(20) << "Due Date" << "\n";
-        std::cout << std::string(110, '-') << "\n";
+    bool empty() const { return containers.empty(); }
+    void clear() { containers.clear(); }
 
-        for (const auto& task : sorted_tasks) {
-            std::cout << std::left << std::setw(5) << task.id
-                      << std::setw(30) << task.description
-                      << std::setw(10) << (task.completed ? "Done" : "Pending")
-                      << std::setw(10) << priority_to_string(task.priority)
-                      << std::setw(15) << task.category
-                      << std::setw(20) << date::format("%Y-%m-%d %H:%M", task.created_at)
-                      << std::setw(20) << (task.due_date ? date::format("%Y-%m-%d", *task.due_date) : "None")
-                      << "\n";
+    // Calls fn(value) for every member in ascending order
+    template <typename Fn>
+    void for_each(Fn fn) const {
+        for (const auto& c : containers) {
+            const uint32_t base = static_cast<uint32_t>(c.key) << 16;
+            if (c.is_bitmap()) {
+                for (size_t w = 0; w < kWords; w++) {
+                    for (uint64_t word = c.bits[w]; word; word &= word - 1) {
+                        fn(base + static_cast<uint32_t>(w * 64 + __builtin_ctzll(word)));
+                    }
+                }
+            } else {
+                for (uint16_t low : c.array) fn(base + low);
+            }
         }
-        std::cout << "\n";
     }
 
-    // Mark a task as complete
-    void complete_task(int id) {
-        auto it = std::find_if(tasks.begin(), tasks.end(), [id](const Task& t) { return t.id == id; });
-        if (it != tasks.end()) {
-            it->completed = true;
-            std::cout << "Task " << id << " marked as complete.\n";
-            save_tasks();
-        } else {
-            std::cout << "Task with ID " << id << " not found.\n";
+    friend RoaringBitmap operator&(const RoaringBitmap& a, const RoaringBitmap& b) {
+        RoaringBitmap out;
+        size_t i = 0, j = 0;
+        while (i < a.containers.size() && j < b.containers.size()) {
+            const Container& x = a.containers[i];
+            const Container& y = b.containers[j];
+            if (x.key < y.key) {
+                i++;
+            } else if (y.key < x.key) {
+                j++;
+            } else {
+                out.push(combine<BitOp::And>(x, y));
+                i++;
+                j++;
+            }
         }
+        return out;
     }
 
-    // Delete a task
-    void delete_task(int id) {
-        auto it = std::find_if(tasks.begin(), tasks.end(), [id](const Task& t) { return t.id == id; });
-        if (it != tasks.end()) {
-            tasks.erase(it);
-            std::cout << "Task " << id << " deleted.\n";
-            save_tasks();
-        } else {
-            std::cout << "Task with ID " << id << " not found.\n";
+    friend RoaringBitmap operator|(const RoaringBitmap& a, const RoaringBitmap& b) {
+        RoaringBitmap out;
+        size_t i = 0, j = 0;
+        while (i < a.containers.size() || j < b.containers.size()) {
+            if (j == b.containers.size() || (i < a.containers.size() && a.containers[i].key < b.containers[j].key)) {
+                out.containers.push_back(a.containers[i++]);
+            } else if (i == a.containers.size() || b.containers[j].key < a.containers[i].key) {
+                out.containers.push_back(b.containers[j++]);
+            } else {
+                out.push(combine<BitOp::Or>(a.containers[i++], b.containers[j++]));
+            }
         }
+        return out;
     }
 
-    // Clear all tasks
-    void clear_tasks() {
-        tasks.clear();
-        next_id = 1;
-        std::cout << "All tasks cleared.\n";
-        save_tasks();
+    // Members of a that are not in b
+    static RoaringBitmap and_not(const RoaringBitmap& a, const RoaringBitmap& b) {
+        RoaringBitmap out;
+        size_t j = 0;
+        for (const Container& x : a.containers) {
+            while (j < b.containers.size() && b.containers[j].key < x.key) j++;
+            if (j < b.containers.size() && b.containers[j].key == x.key) {
+                out.push(combine<BitOp::AndNot>(x, b.containers[j]));
+            } else {
+                out.containers.push_back(x);
+            }
+        }
+        return out;
     }
 
 private:
-    std::vector<Task> tasks;
-    int next_id;
-    std::string file_path;
+    static constexpr uint32_t kArrayMax = 4096;
+    static constexpr size_t kWords = 1024;  // 65536 bits
 
-    // Load tasks from JSON file
-    void load_tasks() {
-        std::ifstream file(file_path);
-        if (!file.is_open()) {
-            return;
+    enum class BitOp { And, Or, AndNot };
+
+    struct Container {
+        uint16_t key = 0;
+        uint32_t cardinality = 0;
+        std::vector<uint16_t> array;  // sorted low halves while sparse
+        std::vector<uint64_t> bits;   // kWords words once dense
+
+        bool is_bitmap() const { return !bits.empty(); }
+
+        bool contains(uint16_t v) const {
+            if (is_bitmap()) return (bits[v >> 6] >> (v & 63)) & 1;
+            return std::binary_search(array.begin(), array.end(), v);
         }
 
-        json j;
-        try {
-            file >> j;
-            tasks = j.get<std::vector<Task>>();
-            if (!tasks.empty()) {
-                next_id = std::max_element(tasks.begin(), tasks.end(),
-                    [](const Task& a, const Task& b) { return a.id < b.id; })->id + 1;
-            }
-        } catch (const json::exception& e) {
-            std::cerr << "Error parsing tasks file: " << e.what() << "\n";
-            tasks.clear();
+        void add(uint16_t v) {
+            if (is_bitmap()) {
+                uint64_t& word = bits[v >> 6];
+                const uint64_t mask = uint64_t(1) << (v & 63);
+                cardinality += !(word & mask);
+                word |= mask;
+                return;
+            }
+            // Slots arrive mostly in ascending order, so try the end first
+            if (array.empty() || array.back() < v) {
+                array.push_back(v);
+            } else {
+                auto it = std::lower_bound(array.begin(), array.end(), v);
+                if (*it == v) return;
+                array.insert(it, v);
+            }
+            cardinality++;
+            if (cardinality > kArrayMax) to_bitmap();
         }
-    }
 
-    // Save tasks with backup
-    void save_tasks() const {
-        // Create backup if file exists
-        if (fs::exists(file_path)) {
-            fs::copy_file(file_path, file_path + ".bak", fs::copy_options::overwrite_existing);
+        void remove(uint16_t v) {
+            if (is_bitmap()) {
+                uint64_t& word = bits[v >> 6];
+                const uint64_t mask = uint64_t(1) << (v & 63);
+                cardinality -= (word & mask) != 0;
+                word &= ~mask;
+                if (cardinality <= kArrayMax) to_array();
+                return;
+            }
+            auto it = std::lower_bound(array.begin(), array.end(), v);
+            if (it != array.end() && *it == v) {
+                array.erase(it);
+                cardinality--;
+            }
         }
 
-        std::ofstream file(file_path);
-        if (!file.is_open()) {
-            std::cerr << "Error: Could not open tasks file for writing.\n";
-            return;
+        void to_bitmap() {
+            bits.assign(kWords, 0);
+            for (uint16_t v : array) bits[v >> 6] |= uint64_t(1) << (v & 63);
+            std::vector<uint16_t>().swap(array);
         }
-        json j = tasks;
-        file << std::setw(4) << j << std::endl;
-    }
-};
 
-// CLI parsing
-cxxopts::Options setup_options() {
-    cxxopts::Options options("TaskManager", "A CLI tool to manage tasks with priorities and categories.");
-    options.add_options()
-        ("c,command", "Command (add|list|complete|delete|clear)", cxxopts::value<std::string>())
-        ("d,description", "Task description", cxxopts::value<std::string>()->default_value(""))
-        ("due-date", "Due date (YYYY-MM-DD)", cxxopts::value<std::string>()->default_value(""))
-        ("p,priority", "Priority (low|medium|high)", cxxopts::value<std::string>()->default_value("medium"))
-        ("category", "Task category", cxxopts::value<std::string>()->default_value("General"))
-        ("s,sort-by", "Sort list by (id|priority|due_date)", cxxopts::value<std::string>()->default_value("id"))
-        ("i,id", "Task ID", cxxopts::value<int>()->default_value("0"))
-        ("h,help", "Print usage");
-    return options;
-}
+        void to_array() {
+            array.clear();
+            array.reserve(cardinality);
+            for (size_t w = 0; w < kWords; w++) {
+                for (uint64_t word = bits[w]; word; word &= word - 1) {
+                    array.push_back(static_cast<uint16_t>(w * 64 + __builtin_ctzll(word)));
+                }
+            }
+            std::vector<uint64_t>().swap(bits);
+        }
+    };
 
-// Parse priority from string
-Priority parse_priority(const std::string& p) {
-    if (p == "low") return Priority::Low;
-    if (p == "high") return Priority::High;
-    return Priority::Medium;
-}
+    std::vector<Container> containers;  // sorted by key
 
-// Main function
-int main(int argc, char* argv[]) {
-    auto options = setup_options();
-    try {
-        auto result = options.parse(argc, argv);
+    std::vector<Container>::iterator find(uint16_t key) {
+        auto it = std::lower_bound(containers.begin(), containers.end(), key,
+            [](const Container& c, uint16_t k) { return c.key < k; });
+        return it != containers.end() && it->key == key ? it : containers.end();
+    }
 
-        if (result.count("help") || !result.count("command")) {
-            std::cout << options.help() << std::endl;
-            return 0;
+    Container& container_for(uint16_t key) {
+        if (!containers.empty() && containers.back().key == key) return containers.back();
+        auto it = std::lower_bound(containers.begin(), containers.end(), key,
+            [](const Container& c, uint16_t k) { return c.key < k; });
+        if (it == containers.end() || it->key != key) {
+            it = containers.insert(it, Container());
+            it->key = key;
         }
+        return *it;
+    }
 
-        TaskManager manager("tasks.json");
-        const auto command = result["command"].as<std::string>();
+    void push(Container&& c) {
+        if (c.cardinality > 0) containers.push_back(std::move(c));
+    }
 
-        if (command == "add") {
-            const auto desc = result["description"].as<std::string>();
-            if (desc.empty()) {
-                std::cerr << "Error: Description required for add command.\n";
-                return 1;
-            }
-            const auto due = result["due-date"].as<std::string>();
-            const auto pri = parse_priority(result["priority"].as<std::string>());
-            const auto cat = result["category"].as<std::string>();
-            manager.add_task(desc, due.empty() ? std::nullopt : std::make_optional(due), pri, cat);
-        } else if (command == "list") {
-            const auto sort_by = result["sort-by"].as<std::string>();
-            manager.list_tasks(sort_by);
-        } else if (command == "complete") {
-            const auto id = result["id"].as<int>();
-            if (id <= 0) {
-                std::cerr << "Error: Valid ID required for complete command.\n";
-                return 1;
+    // out = a op b over whole bitmap containers; returns the popcount
+    template <BitOp op>
+    static uint32_t word_kernel(const uint64_t* a, const uint64_t* b, uint64_t* out) {
+#if defined(__SSE2__)
+        for (size_t i = 0; i < kWords; i += 2) {
+            const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+            const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+            __m128i r;
+            if constexpr (op == BitOp::And) r = _mm_and_si128(va, vb);
+            else if constexpr (op == BitOp::Or) r = _mm_or_si128(va, vb);
+            else r = _mm_andnot_si128(vb, va);  // ~b & a
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), r);
+        }
+#else
+        for (size_t i = 0; i < kWords; i++) {
+            if constexpr (op == BitOp::And) out[i] = a[i] & b[i];
+            else if constexpr (op == BitOp::Or) out[i] = a[i] | b[i];
+            else out[i] = a[i] & ~b[i];
+        }
+#endif
+        uint32_t count = 0;
+        for (size_t i = 0; i < kWords; i++) count += static_cast<uint32_t>(__builtin_popcountll(out[i]));
+        return count;
+    }
+
+    // Combine two containers with the same key, choosing the cheapest kernel
+    // for their representations
+    template <BitOp op>
+    static Container combine(const Container& x, const Container& y) {
+        Container out;
+        out.key = x.key;
+        if (x.is_bitmap() && y.is_bitmap()) {
+            out.bits.assign(kWords, 0);
+            out.cardinality = word_kernel<op>(x.bits.data(), y.bits.data(), out.bits.data());
+        } else if (!x.is_bitmap() && !y.is_bitmap()) {
+            auto sink = std::back_inserter(out.array);
+            if constexpr (op == BitOp::And) {
+                std::set_intersection(x.array.begin(), x.array.end(), y.array.begin(), y.array.end(), sink);
+            } else if constexpr (op == BitOp::Or) {
+                std::set_union(x.array.begin(), x.array.end(), y.array.begin(), y.array.end(), sink);
+            } else {
+                std::set_difference(x.array.begin(), x.array.end(), y.array.begin(), y.array.end(), sink);
             }
-            manager.complete_task(id);
-        } else if (command == "delete") {
-            const auto id = result["id"].as<int>();
-            if (id <= 0) {
-                std::cerr << "Error: Valid ID required for delete command.\n";
-                return 1;
+            out.cardinality = static_cast<uint32_t>(out.array.size());
+        } else if constexpr (op == BitOp::And) {
+            // Probe the array side against the bitmap side
+            const Container& sparse = x.is_bitmap() ? y : x;
+            const Container& dense = x.is_bitmap() ? x : y;
+            for (uint16_t v : sparse.array) {
+                if (dense.contains(v)) out.array.push_back(v);
             }
-            manager.delete_task(id);
-        } else if (command == "clear") {
-            manager.clear_tasks();
+            out.cardinality = static_cast<uint32_t>(out.array.size());
+        } else if constexpr (op == BitOp::Or) {
+            out = x.is_bitmap() ? x : y;
+            for (uint16_t v : (x.is_bitmap() ? y : x).array) out.add(v);
+            out.key = x.key;
+        } else if (x.is_bitmap()) {
+            out = x;
+            for (uint16_t v : y.array) out.remove(v);
+            return out;
         } else {
-            std::cerr << "Unknown command: " << command << "\n";
-            std::cout << options.help() << std::endl;
-            return 1;
+            for (uint16_t v : x.array) {
+                if (!y.contains(v)) out.array.push_back(v);
+            }
+            out.cardinality = static_cast<uint32_t>(out.array.size());
         }
-    } catch (const cxxopts::OptionException& e) {
-        std::cerr << "Error parsing options: " << e.what() << "\n";
-        std::cout << options.help() << std::endl;
-        return 1;
+        if (out.is_bitmap() && out.cardinality <= kArrayMax) {
+            out.to_array();
+        } else if (!out.is_bitmap() && out.cardinality > kArrayMax) {
+            out.to_bitmap();
+        }
+        return out;
     }
+};
 
-    return 0;
-}
+// A --where expression compiled to a flat predicate tree. Tests are
+// normalized while parsing: priority tests become a mask of accepted
+// priorities, due and id tests half-open ranges, category tests a sorted
+// name set. Constant subtrees fold away, tests on the same column under one
+// && or || merge into a single test, and ! is pushed into a test where the
+// test can absorb it.
+//
+//   expr  := term (("||" | "or") term)*
+//   term  := unary (("&&" | "and") unary)*
+//   unary := ("!" | "not") unary | "(" expr ")" | test
+//   test  := "completed" | "pending" | "true" | "false"
+//          | field op value | field "in" "(" value ("," value)* ")"
+//   field := "priority" | "category" | "due" | "id" | "completed"
+//   op    := "==" | "=" | "!=" | "<" | "<=" | ">" | ">="
+//
+// Due dates are YYYY-MM-DD or "today" and compare whole days. "due==none"
+// matches undated tasks; other due tests never do, though their negations do.
+class FilterExpr {
+public:
+    enum class Kind : uint8_t { Const, And, Or, Not, Priority, Completed, Category, Due, Id };
 
-// Tests
-void run_tests() {
-    TaskManager tm("test_tasks.json");
-    std::cout << "Running tests...\n";
+    struct Node {
+        Kind kind = Kind::Const;
+        bool value = true;                    // Const: the result; Completed: the flag required
+        uint8_t priorities = 0;               // Priority: bit 1 << Priority per accepted value
+        std::vector<std::string> categories;  // Category: accepted names, sorted
+        int64_t lo = 0;                       // Due, Id: accepted range [lo, hi)
+        int64_t hi = 0;
+        std::vector<int> children;            // And, Or: operands; Not: its operand
+    };
 
-    // Test 1: Add task
-    tm.add_task("Test task", std::nullopt, Priority::Medium, "General");
-    if (tm.tasks.size() != 1 || tm.tasks[0].description != "Test task") {
-        std::cerr << "Test 1 failed: Add task\n";
-        return;
+    // Compile text; on a syntax error returns nullopt and describes it in error
+    static std::optional<FilterExpr> parse(std::string_view text, std::string& error) {
+        FilterExpr expr;
+        Parser parser(expr, text);
+        const auto root = parser.parse();
+        if (!root) {
+            error = parser.error;
+            return std::nullopt;
+        }
+        expr.root_node = *root;
+        return expr;
     }
 
-    // Test 2: Complete task
-    tm.complete_task(1);
-    if (!tm.tasks[0].completed) {
-        std::cerr << "Test 2 failed: Complete task\n";
-        return;
+    // Matches everything until built on
+    FilterExpr() { root_node = constant(true); }
+
+    int root() const { return root_node; }
+    void set_root(int n) { root_node = n; }
+    const Node& node(int n) const { return nodes[n]; }
+    size_t size() const { return nodes.size(); }
+
+    // Folding constructors, also for building expressions in code. Each
+    // returns a node index and may append to nodes, so callers must not hold
+    // a Node reference across them.
+    int constant(bool value) {
+        Node n;
+        n.value = value;
+        return add(std::move(n));
     }
 
-    // Test 3: Add task with priority and category
-    tm.add_task("High priority task", std::nullopt, Priority::High, "Work");
-    if (tm.tasks.size() != 2 || tm.tasks[1].priority != Priority::High || tm.tasks[1].category != "Work") {
-        std::cerr << "Test 3 failed: Add task with priority and category\n";
-        return;
+    int priority_test(uint8_t mask) {
+        if (mask == 0 || mask == kAllPriorities) return constant(mask != 0);
+        Node n;
+        n.kind = Kind::Priority;
+        n.priorities = mask;
+        return add(std::move(n));
     }
 
-    // Test 4: Delete task
-    tm.delete_task(1);
-    if (tm.tasks.size() != 1 || tm.tasks[0].id != 2) {
-        std::cerr << "Test 4 failed: Delete task\n";
-        return;
+    int completed_test(bool done) {
+        Node n;
+        n.kind = Kind::Completed;
+        n.value = done;
+        return add(std::move(n));
     }
 
-    // Test 5: Clear tasks
-    tm.clear_tasks();
-    if (!tm.tasks.empty() || tm.next_id != 1) {
-        std::cerr << "Test 5 failed: Clear tasks\n";
-        return;
+    int category_test(std::vector<std::string> names) {
+        if (names.empty()) return constant(false);
+        Node n;
+        n.kind = Kind::Category;
+        n.categories = std::move(names);
+        return add(std::move(n));
     }
 
-    // Test 6: Persistence
-    tm.add_task("Persistent task", std::nullopt, Priority::Low, "Personal");
-    TaskManager tm2("test_tasks.json");
-    if (tm2.tasks.size() != 1 || tm2.tasks[0].description != "Persistent task") {
-        std::cerr << "Test 6 failed: Persistence\n";
-        return;
+    int range_test(Kind kind, int64_t lo, int64_t hi) {
+        if (kind == Kind::Id) {
+            lo = std::max<int64_t>(lo, 1);  // ids start at 1
+            if (lo == 1 && hi == kMax) return constant(true);
+        }
+        if (lo >= hi) return constant(false);
+        Node n;
+        n.kind = kind;
+        n.lo = lo;
+        n.hi = hi;
+        return add(std::move(n));
     }
 
-    std::cout << "All tests passed.\n";
+    int negate(int a) {
+        const Node& x = nodes[a];
+        switch (x.kind) {
+            case Kind::Const: return constant(!x.value);
+            case Kind::Not: return x.children[0];
+            case Kind::Priority: return priority_test(kAllPriorities & ~x.priorities);
+            case Kind::Completed: return completed_test(!x.value);
+            default: break;
+        }
+        Node n;
+        n.kind = Kind::Not;
+        n.children.push_back(a);
+        return add(std::move(n));
+    }
+
+    // a && b or a || b, flattened, with same-column tests merged and
+    // identity and absorbing constants folded
+    int combine(Kind kind, int a, int b) {
+        const bool is_and = kind == Kind::And;
+        std::vector<int> operands;
+        for (int x : {a, b}) {
+            if (nodes[x].kind == kind) {
+                operands.insert(operands.end(), nodes[x].children.begin(), nodes[x].children.end());
+            } else {
+                operands.push_back(x);
+            }
+        }
+        std::vector<int> merged;
+        for (int x : operands) {
+            bool absorbed = false;
+            for (int& y : merged) {
+                if (auto m = merge(is_and, y, x)) {
+                    y = *m;
+                    absorbed = true;
+                    break;
+                }
+            }
+            if (!absorbed) merged.push_back(x);
+        }
+        Node n;
+        n.kind = kind;
+        for (int x : merged) {
+            if (nodes[x].kind != Kind::Const) {
+                n.children.push_back(x);
+            } else if (nodes[x].value != is_and) {
+                return constant(!is_and);  // false && ..., true || ...
+            }
+        }
+        if (n.children.empty()) return constant(is_and);
+        if (n.children.size() == 1) return n.children[0];
+        return add(std::move(n));
+    }
+
+    bool matches(const TaskView& t) const { return matches(t, root_node); }
+
+    bool matches(const TaskView& t, int n) const {
+        const Node& x = nodes[n];
+        switch (x.kind) {
+            case Kind::Const: return x.value;
+            case Kind::And:
+                return std::all_of(x.children.begin(), x.children.end(), [&](int c) { return matches(t, c); });
+            case Kind::Or:
+                return std::any_of(x.children.begin(), x.children.end(), [&](int c) { return matches(t, c); });
+            case Kind::Not: return !matches(t, x.children[0]);
+            case Kind::Priority: return (x.priorities >> static_cast<int>(t.priority)) & 1;
+            case Kind::Completed: return t.completed == x.value;
+            case Kind::Category:
+                return std::binary_search(x.categories.begin(), x.categories.end(), t.category, std::less<>());
+            case Kind::Due: return t.due_date >= x.lo && t.due_date < x.hi;
+            case Kind::Id: return t.id >= x.lo && t.id < x.hi;
+        }
+        return false;
+    }
+
+    // Readable form of a subtree, as --explain prints it
+    std::string describe(int n) const {
+        const Node& x = nodes[n];
+        auto list = [](const std::vector<std::string>& items) {
+            std::string out;
+            for (const auto& item : items) out += (out.empty() ? "" : ", ") + item;
+            return items.size() == 1 ? " == " + out : " in (" + out + ")";
+        };
+        auto day = [](int64_t secs) { return TimestampFormatter().format(secs, TimeLayout::Date); };
+        switch (x.kind) {
+            case Kind::Const: return x.value ? "true" : "false";
+            case Kind::And:
+            case Kind::Or: {
+                std::string out;
+                for (int c : x.children) {
+                    const bool group = nodes[c].kind == Kind::And || nodes[c].kind == Kind::Or;
+                    if (!out.empty()) out += x.kind == Kind::And ? " && " : " || ";
+                    out += group ? "(" + describe(c) + ")" : describe(c);
+                }
+                return out;
+            }
+            case Kind::Not: return "!(" + describe(x.children[0]) + ")";
+            case Kind::Priority: {
+                std::vector<std::string> names;
+                for (int p = 0; p < 3; p++) {
+                    if ((x.priorities >> p) & 1) names.push_back(priority_to_string(static_cast<Priority>(p)));
+                }
+                return "priority" + list(names);
+            }
+            case Kind::Completed: return x.value ? "completed" : "!completed";
+            case Kind::Category: return "category" + list(x.categories);
+            case Kind::Due:
+                if (x.lo == kDueMin && x.hi == kMax) return "due != none";
+                if (x.lo == kDueMin) return "due < " + day(x.hi);
+                if (x.hi == kMax) return "due >= " + day(x.lo);
+                if (x.hi - x.lo == 86400) return "due == " + day(x.lo);
+                return "due >= " + day(x.lo) + " && due < " + day(x.hi);
+            case Kind::Id:
+                if (x.hi - x.lo == 1) return "id == " + std::to_string(x.lo);
+                if (x.hi == kMax) return "id >= " + std::to_string(x.lo);
+                if (x.lo == 1) return "id < " + std::to_string(x.hi);
+                return "id >= " + std::to_string(x.lo) + " && id < " + std::to_string(x.hi);
+        }
+        return "";
+    }
+
+private:
+    static constexpr uint8_t kAllPriorities = 0b111;
+    static constexpr int64_t kDueMin = kNoDueDate + 1;  // due ranges never take in undated tasks
+    static constexpr int64_t kMax = INT64_MAX;
+    static constexpr int kMaxDepth = 256;
+
+    std::vector<Node> nodes;
+    int root_node = 0;
+
+    int add(Node n) {
+        nodes.push_back(std::move(n));
+        return static_cast<int>(nodes.size() - 1);
+    }
+
+    // Merge two tests on the same column into one, if the result is a test
+    std::optional<int> merge(bool is_and, int a, int b) {
+        const Node& x = nodes[a];
+        const Node& y = nodes[b];
+        if (x.kind != y.kind) return std::nullopt;
+        switch (x.kind) {
+            case Kind::Priority:
+                return priority_test(is_and ? x.priorities & y.priorities : x.priorities | y.priorities);
+            case Kind::Completed:
+                return x.value == y.value ? a : constant(!is_and);  // c && !c, c || !c
+            case Kind::Category: {
+                std::vector<std::string> names;
+                if (is_and) {
+                    std::set_intersection(x.categories.begin(), x.categories.end(), y.categories.begin(),
+                                          y.categories.end(), std::back_inserter(names));
+                } else {
+                    std::set_union(x.categories.begin(), x.categories.end(), y.categories.begin(),
+                                   y.categories.end(), std::back_inserter(names));
+                }
+                return category_test(std::move(names));
+            }
+            case Kind::Due:
+            case Kind::Id: {
+                const Kind kind = x.kind;
+                const int64_t lo = is_and ? std::max(x.lo, y.lo) : std::min(x.lo, y.lo);
+                const int64_t hi = is_and ? std::min(x.hi, y.hi) : std::max(x.hi, y.hi);
+                if (!is_and && std::max(x.lo, y.lo) > std::min(x.hi, y.hi)) {
+                    return std::nullopt;  // disjoint ranges do not union into one
+                }
+                return range_test(kind, lo, hi);
+            }
+            default:
+                return std::nullopt;
+        }
+    }
+
+    // Recursive descent over a hand-rolled tokenizer
+    struct Parser {
+        FilterExpr& expr;
+        std::string_view text;
+        size_t pos = 0;
+        int depth = 0;
+        std::string error;
+
+        Parser(FilterExpr& expr, std::string_view text) : expr(expr), text(text) {}
+
+        struct Token {
+            enum Type { End, Word, Quoted, Symbol } type = End;
+            std::string text;
+        };
+
+        std::optional<int> parse() {
+            const auto root = parse_or();
+            if (root && peek().type != Token::End) return fail("unexpected '" + peek().text + "'");
+            return root;
+        }
+
+        std::nullopt_t fail(std::string message) {
+            if (error.empty()) error = std::move(message);
+            return std::nullopt;
+        }
+
+        static bool is_symbol_char(char c) {
+            return std::strchr("!()<>=,&|", c) != nullptr;
+        }
+
+        Token lex(size_t& at) const {
+            while (at < text.size() && std::isspace(static_cast<unsigned char>(text[at]))) at++;
+            Token t;
+            if (at >= text.size()) return t;
+            const char c = text[at];
+            if (c == '"' || c == '\'') {
+                const size_t close = text.find(c, at + 1);
+                t.type = Token::Quoted;
+                t.text = std::string(text.substr(at + 1, close == std::string_view::npos ? close : close - at - 1));
+                at = close == std::string_view::npos ? text.size() : close + 1;
+                return t;
+            }
+            if (is_symbol_char(c)) {
+                static const char* const kPairs[] = {"&&", "||", "==", "!=", "<=", ">="};
+                t.type = Token::Symbol;
+                for (const char* pair : kPairs) {
+                    if (text.substr(at, 2) == pair) {
+                        t.text = pair;
+                        at += 2;
+                        return t;
+                    }
+                }
+                t.text = std::string(1, c);
+                at++;
+                return t;
+            }
+            const size_t start = at;
+            while (at < text.size() && !std::isspace(static_cast<unsigned char>(text[at])) &&
+                   !is_symbol_char(text[at]) && text[at] != '"' && text[at] != '\'') {
+                at++;
+            }
+            t.type = Token::Word;
+            t.text = std::string(text.substr(start, at - start));
+            return t;
+        }
+
+        Token peek() const {
+            size_t at = pos;
+            return lex(at);
+        }
+
+        Token next() { return lex(pos); }
+
+        // Symbol, or keyword spelled as an unquoted word (any case)
+        bool accept(const char* symbol, const char* keyword = nullptr) {
+            const Token t = peek();
+            if ((t.type == Token::Symbol && t.text == symbol) ||
+                (keyword && t.type == Token::Word && lowercase(t.text) == keyword)) {
+                next();
+                return true;
+            }
+            return false;
+        }
+
+        static std::string lowercase(std::string s) {
+            std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return std::tolower(c); });
+            return s;
+        }
+
+        std::optional<int> parse_or() {
+            auto lhs = parse_and();
+            while (lhs && accept("||", "or")) {
+                const auto rhs = parse_and();
+                if (!rhs) return std::nullopt;
+                lhs = expr.combine(Kind::Or, *lhs, *rhs);
+            }
+            return lhs;
+        }
+
+        std::optional<int> parse_and() {
+            auto lhs = parse_unary();
+            while (lhs && accept("&&", "and")) {
+                const auto rhs = parse_unary();
+                if (!rhs) return std::nullopt;
+                lhs = expr.combine(Kind::And, *lhs, *rhs);
+            }
+            return lhs;
+        }
+
+        std::optional<int> parse_unary() {
+            if (++depth > kMaxDepth) return fail("expression nests too deeply");
+            std::optional<int> result;
+            if (accept("!", "not")) {
+                result = parse_unary();
+                if (result) result = expr.negate(*result);
+            } else if (accept("(")) {
+                result = parse_or();
+                if (result && !accept(")")) result = fail("expected ')'");
+            } else {
+                result = parse_test();
+            }
+            depth--;
+            return result;
+        }
+
+        std::optional<int> parse_test() {
+            const Token field = next();
+            const std::string name = lowercase(field.text);
+            if (field.type != Token::Word) {
+                return fail(field.type == Token::End ? "expected a test, got the end of the expression"
+                                                     : "expected a test, got '" + field.text + "'");
+            }
+            if (name == "true" || name == "false") return expr.constant(name == "true");
+            if (name == "pending") return expr.completed_test(false);
+            if (name != "priority" && name != "category" && name != "due" && name != "id" && name != "completed") {
+                return fail("unknown field '" + field.text + "'");
+            }
+
+            const Token op = peek();
+            if (name == "completed" && (op.type != Token::Symbol || op.text == ")" || op.text == "&&" ||
+                                        op.text == "||" || op.text == ",")) {
+                return expr.completed_test(true);
+            }
+            std::vector<Token> values;
+            std::string comparison;
+            if (accept("in", "in")) {
+                comparison = "in";
+                if (!accept("(")) return fail("expected '(' after in");
+                do {
+                    values.push_back(next());
+                } while (accept(","));
+                if (!accept(")")) return fail("expected ')' to close the in list");
+            } else {
+                next();
+                comparison = op.text == "=" ? "==" : op.text;
+                static const char* const kComparisons[] = {"==", "!=", "<", "<=", ">", ">="};
+                if (op.type != Token::Symbol ||
+                    std::none_of(std::begin(kComparisons), std::end(kComparisons),
+                                 [&](const char* c) { return comparison == c; })) {
+                    return fail("expected a comparison after '" + field.text + "'");
+                }
+                values.push_back(next());
+            }
+            for (const Token& v : values) {
+                if (v.type != Token::Word && v.type != Token::Quoted) {
+                    return fail("expected a value for '" + field.text + "'");
+                }
+            }
+
+            if (name == "priority") return priority(comparison, values);
+            if (name == "category") return category(comparison, values);
+            if (name == "completed") return completed(comparison, values);
+            return range(name == "due" ? Kind::Due : Kind::Id, comparison, values);
+        }
+
+        std::optional<int> priority(const std::string& comparison, const std::vector<Token>& values) {
+            uint8_t mask = 0;
+            for (const Token& v : values) {
+                const std::string word = lowercase(v.text);
+                int p;
+                if (word == "low") p = static_cast<int>(Priority::Low);
+                else if (word == "medium") p = static_cast<int>(Priority::Medium);
+                else if (word == "high") p = static_cast<int>(Priority::High);
+                else return fail("unknown priority '" + v.text + "'");
+
+                const uint8_t at = 1u << p;
+                const uint8_t below = at - 1;
+                if (comparison == "in" || comparison == "==") mask |= at;
+                else if (comparison == "!=") mask = kAllPriorities & ~at;
+                else if (comparison == "<") mask = below;
+                else if (comparison == "<=") mask = below | at;
+                else if (comparison == ">") mask = kAllPriorities & ~(below | at);
+                else mask = kAllPriorities & ~below;
+            }
+            return expr.priority_test(mask);
+        }
+
+        std::optional<int> category(const std::string& comparison, const std::vector<Token>& values) {
+            if (comparison != "in" && comparison != "==" && comparison != "!=") {
+                return fail("category only compares with ==, != and in");
+            }
+            std::vector<std::string> names;
+            for (const Token& v : values) names.push_back(v.text);
+            std::sort(names.begin(), names.end());
+            names.erase(std::unique(names.begin(), names.end()), names.end());
+            const int test = expr.category_test(std::move(names));
+            return comparison == "!=" ? expr.negate(test) : test;
+        }
+
+        std::optional<int> completed(const std::string& comparison, const std::vector<Token>& values) {
+            const std::string word = lowercase(values[0].text);
+            if ((comparison != "==" && comparison != "!=") || (word != "true" && word != "false")) {
+                return fail("completed only compares with == or != against true or false");
+            }
+            return expr.completed_test((word == "true") == (comparison == "=="));
+        }
+
+        // Due dates compare whole days; ids compare exactly
+        std::optional<int> range(Kind kind, const std::string& comparison, const std::vector<Token>& values) {
+            const bool due = kind == Kind::Due;
+            const int64_t unit = due ? 86400 : 1;
+            const int64_t min = due ? kDueMin : 1;
+            std::optional<int> result;
+            for (const Token& v : values) {
+                int64_t at;
+                if (due && lowercase(v.text) == "none") {
+                    if (comparison != "==" && comparison != "!=") return fail("due only compares with none by == or !=");
+                    const int dated = expr.range_test(Kind::Due, kDueMin, kMax);
+                    return comparison == "==" ? expr.negate(dated) : dated;
+                }
+                if (due && lowercase(v.text) == "today") {
+                    const int64_t now = to_epoch_seconds(system_clock::now());
+                    at = now - ((now % 86400) + 86400) % 86400;
+                } else if (due) {
+                    if (!parse_fixed_timestamp(v.text, false, at)) {
+                        return fail("expected a date as YYYY-MM-DD, got '" + v.text + "'");
+                    }
+                } else {
+                    int id = 0;
+                    const char* last = v.text.data() + v.text.size();
+                    const auto parsed = std::from_chars(v.text.data(), last, id);
+                    if (v.text.empty() || parsed.ec != std::errc() || parsed.ptr != last || id < 0) {
+                        return fail("expected an id, got '" + v.text + "'");
+                    }
+                    at = id;
+                }
+
+                int test;
+                if (comparison == "in" || comparison == "==") test = expr.range_test(kind, at, at + unit);
+                else if (comparison == "<") test = expr.range_test(kind, min, at);
+                else if (comparison == "<=") test = expr.range_test(kind, min, at + unit);
+                else if (comparison == ">") test = expr.range_test(kind, at + unit, kMax);
+                else if (comparison == ">=") test = expr.range_test(kind, at, kMax);
+                else test = expr.combine(Kind::Or, expr.range_test(kind, min, at), expr.range_test(kind, at + unit, kMax));
+                result = result ? expr.combine(Kind::Or, *result, test) : test;
+            }
+            return result;
+        }
+    };
+};
+
+// Columnar (struct-of-arrays) task storage. Every field lives in its own
+// contiguous array and strings live in one shared heap, so a scan over a
+// single field (the tombstone check, priority, due date, category) only pulls
+// that column through the cache. Categories are dictionary ids. Slots with
+// id 0 are tombstones awaiting compact(). TaskViews borrow the heap and stay
+// valid until the next mutation.
+//
+// The store also keeps a RoaringBitmap of live slots per priority, per
+// category and for completed tasks, so filters on those columns combine
+// bitmaps instead of scanning, and ColumnStats for the query planner.
+//
+// Columns and heap are carved from a monotonic arena. Loaders size it from
+// the file up front, so a load is a handful of upstream allocations and
+// teardown releases the arena in one go instead of freeing row by row.
+class TaskStore {
+public:
+    // Row counts the query planner estimates selectivity from, kept current
+    // on every write: live and completed rows, rows per priority and per
+    // category, and a histogram of due dates in week-wide buckets
+    struct ColumnStats {
+        static constexpr int64_t kBucketSeconds = 7 * 86400;
+
+        size_t live = 0;
+        size_t done = 0;
+        size_t undated = 0;
+        std::array<size_t, 3> priority{};           // indexed by Priority
+        std::vector<size_t> category;               // indexed by dictionary id
+        std::map<int64_t, size_t> due_buckets;      // bucket start -> rows
+
+        static int64_t bucket_of(int64_t due) {
+            return due - ((due % kBucketSeconds) + kBucketSeconds) % kBucketSeconds;
+        }
+
+        // Estimated rows with lo <= due < hi, taking due dates as spread
+        // evenly across each bucket
+        double due_between(int64_t lo, int64_t hi) const {
+            auto it = due_buckets.upper_bound(lo);
+            if (it != due_buckets.begin()) --it;
+            double rows = 0;
+            for (; it != due_buckets.end() && it->first < hi; ++it) {
+                const double start = std::max<double>(lo, it->first);
+                const double stop = std::min<double>(hi, it->first + kBucketSeconds);
+                if (stop > start) rows += it->second * (stop - start) / kBucketSeconds;
+            }
+            return rows;
+        }
+    };
+
+    // Yields a TaskView per live slot, skipping tombstones
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = TaskView;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = TaskView;
+
+        const_iterator(const TaskStore* store, size_t slot) : store(store), slot(slot) { skip_dead(); }
+
+        TaskView operator*() const { return (*store)[slot]; }
+        const_iterator& operator++() { slot++; skip_dead(); return *this; }
+        bool operator==(const const_iterator& other) const { return slot == other.slot; }
+        bool operator!=(const const_iterator& other) const { return slot != other.slot; }
+
+    private:
+        const TaskStore* store;
+        size_t slot;
+
+        void skip_dead() {
+            while (slot < store->size() && !store->is_live(slot)) slot++;
+        }
+    };
+
+    explicit TaskStore(std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : upstream(upstream) {
+        reset();
+    }
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, size()); }
+
+    // Slot count, tombstones included
+    size_t size() const { return cols->ids.size(); }
+    bool empty() const { return cols->ids.empty(); }
+
+    // Arena bytes needed to hold rows with heap_bytes of description text
+    static size_t arena_bytes_for(size_t rows, size_t heap_bytes) {
+        return rows * kRowBytes + heap_bytes + kArenaSlack;
+    }
+
+    // Drop every row and start over on a fresh arena of at least arena_bytes
+    void reset(size_t arena_bytes = 0) {
+        cols.reset();
+        arena = std::make_unique<std::pmr::monotonic_buffer_resource>(std::max(arena_bytes, kMinArenaBytes), upstream);
+        cols = std::make_unique<Columns>(arena.get());
+        dictionary.clear();
+        live_rows.clear();
+        done_rows.clear();
+        for (auto& rows : priority_rows) rows.clear();
+        category_rows.clear();
+        column_stats = ColumnStats();
+    }
+
+    void reserve(size_t slots, size_t heap_bytes = 0) {
+        cols->reserve(slots, heap_bytes);
+    }
+
+    void clear() {
+        reset();
+    }
+
+    void push_back(const TaskView& t) {
+        Columns& c = *cols;
+        c.ids.push_back(t.id);
+        c.priorities.push_back(static_cast<uint8_t>(t.priority));
+        c.completed.push_back(t.completed);
+        c.created.push_back(t.created_at);
+        c.due.push_back(t.due_date);
+        c.descriptions.push_back(store_string(t.description));
+        c.category_ids.push_back(dictionary.intern(t.category));
+        index_slot(c.ids.size() - 1);
+    }
+
+    void push_back(const Task& t) {
+        push_back(view_of(t));
+    }
+
+    // Overwrite a slot in place; the old strings become heap garbage until compact()
+    void assign(size_t slot, const TaskView& t) {
+        Columns& c = *cols;
+        unindex_slot(slot);
+        c.ids[slot] = t.id;
+        c.priorities[slot] = static_cast<uint8_t>(t.priority);
+        c.completed[slot] = t.completed;
+        c.created[slot] = t.created_at;
+        c.due[slot] = t.due_date;
+        c.descriptions[slot] = store_string(t.description);
+        c.category_ids[slot] = dictionary.intern(t.category);
+        index_slot(slot);
+    }
+
+    TaskView operator[](size_t slot) const {
+        const Columns& c = *cols;
+        return TaskView{c.ids[slot], string_at(c.descriptions[slot]), c.completed[slot] != 0,
+                        static_cast<Priority>(c.priorities[slot]), dictionary.name(c.category_ids[slot]),
+                        c.created[slot], c.due[slot]};
+    }
+
+    int id(size_t slot) const { return cols->ids[slot]; }
+    uint32_t category_id(size_t slot) const { return cols->category_ids[slot]; }
+    const CategoryDictionary& categories() const { return dictionary; }
+    bool is_live(size_t slot) const { return cols->ids[slot] != 0; }
+    bool is_completed(size_t slot) const { return cols->completed[slot] != 0; }
+    Priority priority(size_t slot) const { return static_cast<Priority>(cols->priorities[slot]); }
+    int64_t due_date(size_t slot) const { return cols->due[slot]; }
+
+    void set_completed(size_t slot) {
+        if (is_live(slot) && !cols->completed[slot]) {
+            done_rows.add(static_cast<uint32_t>(slot));
+            column_stats.done++;
+        }
+        cols->completed[slot] = 1;
+    }
+
+    void retire(size_t slot) {
+        unindex_slot(slot);
+        cols->ids[slot] = 0;
+    }
+
+    // Live slots overall, completed, with a priority, in a category
+    const RoaringBitmap& live() const { return live_rows; }
+    const RoaringBitmap& done() const { return done_rows; }
+    const RoaringBitmap& with_priority(Priority p) const { return priority_rows[static_cast<size_t>(p)]; }
+
+    const RoaringBitmap& in_category(uint32_t category) const {
+        static const RoaringBitmap none;
+        return category < category_rows.size() ? category_rows[category] : none;
+    }
+
+    const ColumnStats& stats() const { return column_stats; }
+
+    // Live slots matching expr, by a scan of the columns a block at a time:
+    // each node fills a byte mask for the block from one branch-free loop
+    // over its column, which the compiler vectorizes, and && / || / ! combine
+    // the masks. For filters no index can answer.
+    RoaringBitmap scan(const FilterExpr& expr) const {
+        constexpr size_t kBlock = 1024;
+        using Kind = FilterExpr::Kind;
+        const Columns& c = *cols;
+
+        // Category tests become a lookup table over dictionary ids
+        std::vector<std::vector<uint8_t>> tables(expr.size());
+        for (size_t n = 0; n < expr.size(); n++) {
+            if (expr.node(static_cast<int>(n)).kind != Kind::Category) continue;
+            tables[n].assign(dictionary.size(), 0);
+            for (const auto& name : expr.node(static_cast<int>(n)).categories) {
+                if (auto id = dictionary.find(name)) tables[n][*id] = 1;
+            }
+        }
+
+        std::vector<uint8_t> scratch(expr.size() * kBlock);  // one block mask per node
+        RoaringBitmap rows;
+        for (size_t begin = 0; begin < size(); begin += kBlock) {
+            const size_t count = std::min(kBlock, size() - begin);
+            auto fill = [&](auto& self, int n, uint8_t* out) -> void {
+                const FilterExpr::Node& x = expr.node(n);
+                switch (x.kind) {
+                    case Kind::Const:
+                        std::memset(out, x.value, count);
+                        break;
+                    case Kind::And:
+                    case Kind::Or: {
+                        self(self, x.children[0], out);
+                        for (size_t k = 1; k < x.children.size(); k++) {
+                            uint8_t* other = scratch.data() + x.children[k] * kBlock;
+                            self(self, x.children[k], other);
+                            if (x.kind == Kind::And) {
+                                for (size_t i = 0; i < count; i++) out[i] &= other[i];
+                            } else {
+                                for (size_t i = 0; i < count; i++) out[i] |= other[i];
+                            }
+                        }
+                        break;
+                    }
+                    case Kind::Not:
+                        self(self, x.children[0], out);
+                        for (size_t i = 0; i < count; i++) out[i] ^= 1;
+                        break;
+                    case Kind::Priority: {
+                        const uint8_t* p = c.priorities.data() + begin;
+                        for (size_t i = 0; i < count; i++) out[i] = (x.priorities >> p[i]) & 1;
+                        break;
+                    }
+                    case Kind::Completed: {
+                        const uint8_t* done = c.completed.data() + begin;
+                        const uint8_t want = x.value;
+                        for (size_t i = 0; i < count; i++) out[i] = done[i] == want;
+                        break;
+                    }
+                    case Kind::Category: {
+                        const uint8_t* table = tables[n].data();
+                        const uint32_t* ids = c.category_ids.data() + begin;
+                        for (size_t i = 0; i < count; i++) out[i] = table[ids[i]];
+                        break;
+                    }
+                    case Kind::Due: {
+                        const int64_t* due = c.due.data() + begin;
+                        for (size_t i = 0; i < count; i++) out[i] = (due[i] >= x.lo) & (due[i] < x.hi);
+                        break;
+                    }
+                    case Kind::Id: {
+                        const int32_t* ids = c.ids.data() + begin;
+                        for (size_t i = 0; i < count; i++) out[i] = (ids[i] >= x.lo) & (ids[i] < x.hi);
+                        break;
+                    }
+                }
+            };
+            uint8_t* mask = scratch.data() + expr.root() * kBlock;
+            fill(fill, expr.root(), mask);
+            for (size_t i = 0; i < count; i++) {
+                if (mask[i] && c.ids[begin + i] != 0) rows.add(static_cast<uint32_t>(begin + i));
+            }
+        }
+        return rows;
+    }
+
+    int max_id() const {
+        return empty() ? 0 : *std::max_element(cols->ids.begin(), cols->ids.end());
+    }
+
+    // Sort key computed from the priority and due columns alone
+    uint64_t sort_key(size_t slot, SortBy by) const {
+        return make_sort_key(by, static_cast<Priority>(cols->priorities[slot]), cols->due[slot]);
+    }
+
+    // Copy the live rows into a fresh, exactly sized arena and drop the old
+    // one, taking tombstones and overwritten strings with it
+    void compact() {
+        const Columns& c = *cols;
+        size_t rows = 0;
+        size_t heap_bytes = 0;
+        for (size_t slot = 0; slot < size(); slot++) {
+            if (!is_live(slot)) continue;
+            rows++;
+            heap_bytes += c.descriptions[slot].length;
+        }
+
+        auto fresh_arena = std::make_unique<std::pmr::monotonic_buffer_resource>(
+            std::max(arena_bytes_for(rows, heap_bytes), kMinArenaBytes), upstream);
+        auto fresh = std::make_unique<Columns>(fresh_arena.get());
+        fresh->reserve(rows, heap_bytes);
+        for (size_t slot = 0; slot < size(); slot++) {
+            if (!is_live(slot)) continue;
+            fresh->ids.push_back(c.ids[slot]);
+            fresh->priorities.push_back(c.priorities[slot]);
+            fresh->completed.push_back(c.completed[slot]);
+            fresh->created.push_back(c.created[slot]);
+            fresh->due.push_back(c.due[slot]);
+            const StringRef ref = c.descriptions[slot];
+            fresh->descriptions.push_back({fresh->heap.size(), ref.length});
+            fresh->heap.append(c.heap, ref.offset, ref.length);
+            fresh->category_ids.push_back(c.category_ids[slot]);
+        }
+        cols = std::move(fresh);
+        arena = std::move(fresh_arena);
+
+        // Slots were renumbered
+        live_rows.clear();
+        done_rows.clear();
+        for (auto& rows : priority_rows) rows.clear();
+        category_rows.clear();
+        column_stats = ColumnStats();
+        for (size_t slot = 0; slot < size(); slot++) {
+            index_slot(slot);
+        }
+    }
+
+private:
+    struct StringRef {
+        uint64_t offset;
+        uint32_t length;
+    };
+
+    struct Columns {
+        explicit Columns(std::pmr::memory_resource* r)
+            : ids(r), priorities(r), completed(r), created(r), due(r), descriptions(r), category_ids(r), heap(r) {}
+
+        void reserve(size_t rows, size_t heap_bytes) {
+            ids.reserve(rows);
+            priorities.reserve(rows);
+            completed.reserve(rows);
+            created.reserve(rows);
+            due.reserve(rows);
+            descriptions.reserve(rows);
+            category_ids.reserve(rows);
+            heap.reserve(heap_bytes);
+        }
+
+        std::pmr::vector<int32_t> ids;
+        std::pmr::vector<uint8_t> priorities;
+        std::pmr::vector<uint8_t> completed;
+        std::pmr::vector<int64_t> created;  // epoch seconds
+        std::pmr::vector<int64_t> due;      // epoch seconds, kNoDueDate when unset
+        std::pmr::vector<StringRef> descriptions;
+        std::pmr::vector<uint32_t> category_ids;
+        std::pmr::string heap;
+    };
+
+    static constexpr size_t kRowBytes = sizeof(int32_t) + 2 * sizeof(uint8_t) + 2 * sizeof(int64_t) +
+                                        sizeof(StringRef) + sizeof(uint32_t);
+    static constexpr size_t kArenaSlack = 8 * alignof(std::max_align_t);  // per-column alignment padding
+    static constexpr size_t kMinArenaBytes = 4096;
+
+    std::pmr::memory_resource* upstream;
+    std::unique_ptr<std::pmr::monotonic_buffer_resource> arena;  // declared before cols so it outlives them
+    std::unique_ptr<Columns> cols;
+    CategoryDictionary dictionary;
+    RoaringBitmap live_rows;
+    RoaringBitmap done_rows;
+    std::array<RoaringBitmap, 3> priority_rows;  // indexed by Priority
+    std::vector<RoaringBitmap> category_rows;    // indexed by dictionary id
+    ColumnStats column_stats;
+
+    void index_slot(size_t slot) {
+        if (!is_live(slot)) return;
+        const auto row = static_cast<uint32_t>(slot);
+        const Columns& c = *cols;
+        live_rows.add(row);
+        if (c.completed[slot]) done_rows.add(row);
+        priority_rows[c.priorities[slot]].add(row);
+        if (c.category_ids[slot] >= category_rows.size()) category_rows.resize(c.category_ids[slot] + 1);
+        category_rows[c.category_ids[slot]].add(row);
+        count_slot(slot, 1);
+    }
+
+    void unindex_slot(size_t slot) {
+        if (!is_live(slot)) return;
+        const auto row = static_cast<uint32_t>(slot);
+        const Columns& c = *cols;
+        live_rows.remove(row);
+        done_rows.remove(row);
+        priority_rows[c.priorities[slot]].remove(row);
+        category_rows[c.category_ids[slot]].remove(row);
+        count_slot(slot, -1);
+    }
+
+    // Add (delta 1) or take back (delta -1) a live slot's share of the stats
+    void count_slot(size_t slot, int delta) {
+        const Columns& c = *cols;
+        ColumnStats& st = column_stats;
+        st.live += delta;
+        if (c.completed[slot]) st.done += delta;
+        st.priority[c.priorities[slot]] += delta;
+        if (c.category_ids[slot] >= st.category.size()) st.category.resize(c.category_ids[slot] + 1);
+        st.category[c.category_ids[slot]] += delta;
+        if (c.due[slot] == kNoDueDate) {
+            st.undated += delta;
+        } else {
+            const auto bucket = st.due_buckets.emplace(ColumnStats::bucket_of(c.due[slot]), 0).first;
+            bucket->second += delta;
+            if (bucket->second == 0) st.due_buckets.erase(bucket);
+        }
+    }
+
+    StringRef store_string(std::string_view s) {
+        StringRef ref{cols->heap.size(), static_cast<uint32_t>(s.size())};
+        cols->heap.append(s.data(), s.size());
+        return ref;
+    }
+
+    std::string_view string_at(const StringRef& ref) const {
+        return std::string_view(cols->heap.data() + ref.offset, ref.length);
+    }
+};
+
+// Streaming loader: builds each Task straight from SAX events, so no json DOM
+// is ever held alongside the task store
+class TaskSaxHandler : public nlohmann::json_sax<json> {
+public:
+    explicit TaskSaxHandler(TaskStore& out) : tasks(out) {}
+
+    std::string error;
+
+    bool null() override {
+        if (skipping()) return true;
+        if (depth != 2 || field != Field::DueDate) return fail("unexpected null");
+        current.due_date = kNoDueDate;
+        return mark();
+    }
+
+    bool boolean(bool val) override {
+        if (skipping()) return true;
+        if (depth != 2 || field != Field::Completed) return fail("unexpected boolean");
+        current.completed = val;
+        return mark();
+    }
+
+    bool number_integer(number_integer_t val) override {
+        return integer(static_cast<int64_t>(val));
+    }
+
+    bool number_unsigned(number_unsigned_t val) override {
+        if (skipping()) return true;
+        if (val > static_cast<number_unsigned_t>(INT32_MAX)) return fail("id out of range");
+        return integer(static_cast<int64_t>(val));
+    }
+
+    bool number_float(number_float_t, const string_t&) override {
+        if (skipping()) return true;
+        return fail("unexpected number");
+    }
+
+    bool string(string_t& val) override {
+        if (skipping()) return true;
+        if (depth != 2) return fail("unexpected string");
+        switch (field) {
+            case Field::Description: current.description.assign(val); break;
+            case Field::Category: current.category.assign(val); break;
+            case Field::Priority:
+                current.priority = (val == "Low") ? Priority::Low : (val == "High") ? Priority::High : Priority::Medium;
+                break;
+            case Field::CreatedAt: current.created_at = Task::parse_time(val); break;
+            case Field::DueDate: current.due_date = Task::parse_time(val); break;
+            default: return fail("unexpected string");
+        }
+        return mark();
+    }
+
+    bool binary(binary_t&) override {
+        return fail("unexpected binary value");
+    }
+
+    bool start_object(std::size_t) override {
+        if (depth == 1) {
+            reset_current();
+            seen = 0;
+        } else if (depth < 2 || field != Field::Unknown) {
+            return fail("unexpected object");
+        }
+        depth++;
+        return true;
+    }
+
+    bool key(string_t& val) override {
+        if (depth != 2) return true;
+        if (val == "id") field = Field::Id;
+        else if (val == "description") field = Field::Description;
+        else if (val == "completed") field = Field::Completed;
+        else if (val == "priority") field = Field::Priority;
+        else if (val == "category") field = Field::Category;
+        else if (val == "created_at") field = Field::CreatedAt;
+        else if (val == "due_date") field = Field::DueDate;
+        else field = Field::Unknown;
+        return true;
+    }
+
+    bool end_object() override {
+        depth--;
+        if (depth == 1) {
+            if (seen != kAllFields) return fail("task is missing a required field");
+            tasks.push_back(current);
+        }
+        return true;
+    }
+
+    bool start_array(std::size_t) override {
+        if (depth == 1 || (depth == 2 && field != Field::Unknown)) return fail("unexpected array");
+        depth++;
+        return true;
+    }
+
+    bool end_array() override {
+        depth--;
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& ex) override {
+        return fail(ex.what());
+    }
+
+private:
+    enum class Field { Id, Description, Completed, Priority, Category, CreatedAt, DueDate, Unknown };
+    static constexpr unsigned kAllFields = (1u << static_cast<unsigned>(Field::Unknown)) - 1;
+
+    TaskStore& tasks;
+    Task current;
+    int depth = 0;  // 1 = top-level array, 2 = task object, deeper = ignored value
+    Field field = Field::Unknown;
+    unsigned seen = 0;
+
+    // Clear the scratch task but keep its string capacity, and copy rather
+    // than steal the lexer's buffers, so a load allocates nothing per task
+    void reset_current() {
+        current.id = 0;
+        current.description.clear();
+        current.completed = false;
+        current.priority = Priority::Medium;
+        current.category.clear();
+        current.created_at = 0;
+        current.due_date = kNoDueDate;
+    }
+
+    // Values nested below a task, or under a key we do not know, are ignored
+    bool skipping() const {
+        return depth > 2 || (depth == 2 && field == Field::Unknown);
+    }
+
+    bool integer(int64_t val) {
+        if (skipping()) return true;
+        if (depth != 2 || field != Field::Id) return fail("unexpected number");
+        if (val < INT32_MIN || val > INT32_MAX) return fail("id out of range");
+        current.id = static_cast<int>(val);
+        return mark();
+    }
+
+    bool mark() {
+        seen |= 1u << static_cast<unsigned>(field);
+        return true;
+    }
+
+    bool fail(const std::string& msg) {
+        if (error.empty()) error = msg;
+        return false;
+    }
+};
+
+// Serializes tasks straight into a reusable buffer in the tasks.json schema,
+// without building a json DOM. Pretty output matches nlohmann's setw(4) dump.
+class TaskJsonWriter {
+public:
+    TaskJsonWriter(std::string& buffer, bool compact) : out(buffer), compact(compact) {}
+
+    // Accepts any range of Task or TaskView (std::vector<Task>, TaskStore)
+    template <typename Range>
+    void write(const Range& tasks) {
+        out += '[';
+        bool first = true;
+        for (const auto& task : tasks) {
+            if (!first) out += ',';
+            first = false;
+            newline(1);
+            write_task(view_of(task), 1);
+        }
+        if (!first) newline(0);
+        out += "]\n";
+    }
+
+private:
+    std::string& out;
+    bool compact;
+    TimestampFormatter formatter;
+
+    // Timestamps never need escaping, so they go straight into the buffer
+    void write_time(int64_t secs) {
+        char buf[TimestampFormatter::kMaxLength];
+        out += '"';
+        out.append(buf, formatter.format(secs, TimeLayout::Seconds, buf));
+        out += '"';
+    }
+
+    // Keys in the same (sorted) order nlohmann emits them
+    void write_task(const TaskView& t, int level) {
+        out += '{';
+        key("category", level + 1, true);
+        write_string(t.category);
+        key("completed", level + 1);
+        out += t.completed ? "true" : "false";
+        key("created_at", level + 1);
+        write_time(t.created_at);
+        key("description", level + 1);
+        write_string(t.description);
+        key("due_date", level + 1);
+        if (t.has_due_date()) {
+            write_time(t.due_date);
+        } else {
+            out += "null";
+        }
+        key("id", level + 1);
+        char digits[16];
+        out.append(digits, std::to_chars(digits, digits + sizeof(digits), t.id).ptr);
+        key("priority", level + 1);
+        write_string(priority_to_string(t.priority));
+        newline(level);
+        out += '}';
+    }
+
+    void key(const char* name, int level, bool first = false) {
+        if (!first) out += ',';
+        newline(level);
+        out += '"';
+        out += name;
+        out += compact ? "\":" : "\": ";
+    }
+
+    void newline(int level) {
+        if (!compact) {
+            out += '\n';
+            out.append(static_cast<size_t>(level) * 4, ' ');
+        }
+    }
+
+    void write_string(std::string_view s) {
+        static const char hex[] = "0123456789abcdef";
+        out += '"';
+        size_t run = 0;
+        for (size_t i = 0; i < s.size(); i++) {
+            const unsigned char c = static_cast<unsigned char>(s[i]);
+            if (c >= 0x20 && c != '"' && c != '\\') {
+                continue;
+            }
+            out.append(s.data() + run, i - run);
+            run = i + 1;
+            switch (c) {
+                case '"': out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\b': out += "\\b"; break;
+                case '\f': out += "\\f"; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                case '\t': out += "\\t"; break;
+                default:
+                    out += "\\u00";
+                    out += hex[c >> 4];
+                    out += hex[c & 0xF];
+            }
+        }
+        out.append(s.data() + run, s.size() - run);
+        out += '"';
+    }
+};
+
+// write() until the whole buffer is out; a single call whenever the kernel allows
+bool write_all(int fd, const void* data, size_t len) {
+    const char* p = static_cast<const char*>(data);
+    while (len > 0) {
+        ssize_t n = ::write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool read_all(int fd, void* data, size_t len) {
+    char* p = static_cast<char*>(data);
+    while (len > 0) {
+        ssize_t n = ::read(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Write a whole buffer to path with a single write() whenever the kernel
+// allows, optionally forcing it to stable storage before returning
+bool write_whole_file(const std::string& path, const std::string& data, bool sync = false) {
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    if (!write_all(fd, data.data(), data.size()) || (sync && ::fsync(fd) != 0)) {
+        ::close(fd);
+        return false;
+    }
+    return ::close(fd) == 0;
+}
+
+// fsync an existing file by path
+bool sync_file(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    const bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+}
+
+// fsync the directory containing path so a rename into it survives a crash
+bool sync_parent_dir(const std::string& path) {
+    const fs::path parent = fs::path(path).parent_path();
+    const std::string dir = parent.empty() ? "." : parent.string();
+    int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    const bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+}
+
+// What a listing shows: ordering plus an optional window into the result
+struct ListOptions {
+    SortBy sort_by = SortBy::Id;
+    size_t offset = 0;
+    size_t limit = SIZE_MAX;
+    std::optional<std::string> category;  // only list tasks in this category
+    std::optional<int64_t> due_from;      // only tasks due at or after (epoch seconds)
+    std::optional<int64_t> due_until;     // only tasks due before (epoch seconds)
+    std::optional<Priority> priority;     // only tasks with this priority
+    std::optional<bool> completed;        // only done (true) or pending (false) tasks
+    std::optional<FilterExpr> where;      // only tasks matching a --where expression
+    bool explain = false;                 // print the query plan before the listing
+
+    bool filters_due() const { return due_from || due_until; }
+
+    bool flags_match(Priority p, bool done) const {
+        return (!priority || p == *priority) && (!completed || done == *completed);
+    }
+
+    bool due_in_range(int64_t due) const {
+        return (!due_from || due >= *due_from) && (!due_until || (due != kNoDueDate && due < *due_until));
+    }
+
+    // Every filter above as one expression: --where && the column filters
+    FilterExpr filter() const {
+        using Kind = FilterExpr::Kind;
+        FilterExpr expr = where.value_or(FilterExpr());
+        int root = expr.root();
+        if (category) {
+            root = expr.combine(Kind::And, root, expr.category_test({*category}));
+        }
+        if (priority) {
+            root = expr.combine(Kind::And, root, expr.priority_test(1u << static_cast<int>(*priority)));
+        }
+        if (completed) {
+            root = expr.combine(Kind::And, root, expr.completed_test(*completed));
+        }
+        if (filters_due()) {
+            const int due = expr.range_test(Kind::Due, due_from.value_or(kNoDueDate + 1), due_until.value_or(INT64_MAX));
+            root = expr.combine(Kind::And, root, due);
+        }
+        expr.set_root(root);
+        return expr;
+    }
+};
+
+// How run_plan fetches a listing's rows. The filter's top-level &&
+// operands split into the ones the access path answers and the residual
+// ones checked row by row on its candidates.
+struct QueryPlan {
+    enum class Access { Scan, Bitmaps, DueIndex, IdIndex };
+
+    struct Candidate {
+        Access access;
+        double rows;  // rows the access path yields before residual checks
+        double cost;
+    };
+
+    FilterExpr filter;
+    Access access = Access::Scan;
+    std::vector<int> answered;       // operands the access path answers
+    std::vector<int> residual;       // operands checked per candidate row
+    double estimated_rows = 0;       // rows the whole filter is expected to keep
+    double cost = 0;
+    std::vector<Candidate> considered;  // every access path costed, cheapest chosen
+
+    static const char* name(Access access) {
+        switch (access) {
+            case Access::Scan: return "scan";
+            case Access::Bitmaps: return "bitmaps";
+            case Access::DueIndex: return "due index";
+            case Access::IdIndex: return "id index";
+        }
+        return "";
+    }
+};
+
+// --explain: every access path costed, the chosen one starred, what it
+// answers and checks, and the estimated against the actual row count
+void print_query_plan(const QueryPlan& plan, size_t actual_rows) {
+    const FilterExpr& expr = plan.filter;
+    auto join = [&expr](const std::vector<int>& operands) {
+        std::string out;
+        for (int c : operands) out += (out.empty() ? "" : ", ") + expr.describe(c);
+        return out;
+    };
+    std::cout << "Query plan: " << expr.describe(expr.root()) << "\n";
+    std::cout << "  " << std::left << std::setw(12) << "access" << std::right << std::setw(12) << "est. rows"
+              << std::setw(12) << "cost" << "\n";
+    std::cout << std::fixed << std::setprecision(1);
+    for (const auto& candidate : plan.considered) {
+        std::cout << (candidate.access == plan.access ? "* " : "  ") << std::left << std::setw(12)
+                  << QueryPlan::name(candidate.access) << std::right << std::setw(12) << candidate.rows
+                  << std::setw(12) << candidate.cost << "\n";
+    }
+    if (plan.access != QueryPlan::Access::Scan && !plan.answered.empty()) {
+        std::cout << "Answered by " << QueryPlan::name(plan.access) << ": " << join(plan.answered) << "\n";
+    }
+    if (!plan.residual.empty()) {
+        std::cout << "Checked per row: " << join(plan.residual) << "\n";
+    }
+    std::cout << "Rows: estimated " << plan.estimated_rows << ", actual " << actual_rows << "\n\n";
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+}
+
+// Packed sort entry: a precomputed 64-bit key plus the row it stands for.
+// Sorting these instead of tasks keeps the sort on 16-byte records and
+// never copies a string; ties fall back to file order.
+struct SortEntry {
+    uint64_t key;
+    uint32_t index;
+
+    bool operator<(const SortEntry& other) const {
+        return key != other.key ? key < other.key : index < other.index;
+    }
+};
+
+void print_task_header() {
+    std::cout << "\nTasks:\n";
+    std::cout << std::left << std::setw(5) << "ID"
+              << std::setw(30) << "Description"
+              << std::setw(10) << "Status"
+              << std::setw(10) << "Priority"
+              << std::setw(15) << "Category"
+              << std::setw(20) << "Created At"
+              << std::setw(20) << "Due Date" << "\n";
+    std::cout << std::string(110, '-') << "\n";
+}
+
+void print_task_row(const TaskView& task, TimestampFormatter& formatter) {
+    char created[TimestampFormatter::kMaxLength];
+    char due[TimestampFormatter::kMaxLength];
+    const std::string_view created_str(created, formatter.format(task.created_at, TimeLayout::Minutes, created) - created);
+    const std::string_view due_str = task.has_due_date()
+        ? std::string_view(due, formatter.format(task.due_date, TimeLayout::Date, due) - due)
+        : std::string_view("None");
+    std::cout << std::left << std::setw(5) << task.id
+              << std::setw(30) << task.description
+              << std::setw(10) << (task.completed ? "Done" : "Pending")
+              << std::setw(10) << priority_to_string(task.priority)
+              << std::setw(15) << task.category
+              << std::setw(20) << created_str
+              << std::setw(20) << due_str
+              << "\n";
+}
+
+// Sort and print a task table. order holds the row indices to show;
+// row_at(index) yields the TaskView for a row and key_at(index, by) its sort
+// key. With a limit only the first offset + limit entries are selected
+// (O(N log K)) and only the window is rendered. A presorted order is
+// printed as given.
+template <typename RowAt, typename KeyAt>
+void render_task_list(std::vector<SortEntry>& order, RowAt row_at, KeyAt key_at, const ListOptions& opts,
+                      bool presorted = false) {
+    if (order.empty()) {
+        std::cout << "No tasks found.\n";
+        return;
+    }
+
+    const size_t begin = std::min(opts.offset, order.size());
+    const size_t end = opts.limit < order.size() - begin ? begin + opts.limit : order.size();
+    if (opts.sort_by != SortBy::Id && !presorted) {
+        for (auto& entry : order) {
+            entry.key = key_at(entry.index, opts.sort_by);
+        }
+        if (end < order.size()) {
+            std::partial_sort(order.begin(), order.begin() + end, order.end());
+        } else {
+            std::sort(order.begin(), order.end());
+        }
+    }
+
+    print_task_header();
+    TimestampFormatter formatter;
+    for (size_t i = begin; i < end; i++) {
+        print_task_row(row_at(order[i].index), formatter);
+    }
+    std::cout << "\n";
+}
+
+// On-disk snapshot encoding
+enum class SnapshotFormat { Json, Binary };
+
+// Binary snapshot layout: header, fixed-width records, the category
+// dictionary, then a string heap. Each category name is stored once and
+// records refer to it by index. Integers are host-endian; the file is meant
+// to be mapped, not exchanged.
+constexpr char kBinaryMagic[8] = {'T', 'A', 'S', 'K', 'B', 'I', 'N', '1'};
+constexpr uint32_t kBinaryVersion = 2;
+
+struct BinaryHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t count;
+    uint64_t heap_size;
+    uint32_t category_count;
+    uint32_t reserved;
+};
+
+struct BinaryTaskRecord {
+    int32_t id;
+    uint8_t completed;
+    uint8_t priority;
+    uint16_t reserved;
+    uint32_t category;  // index into the category dictionary
+    uint32_t description_length;
+    int64_t created_at;  // epoch seconds
+    int64_t due_date;    // epoch seconds, kNoDueDate when unset
+    uint64_t description_offset;
+};
+
+struct BinaryCategory {
+    uint64_t offset;  // into the string heap
+    uint32_t length;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(BinaryHeader) == 40, "binary header layout changed");
+static_assert(sizeof(BinaryTaskRecord) == 40, "binary record layout changed");
+static_assert(sizeof(BinaryCategory) == 16, "binary category layout changed");
+
+// Serialize tasks into the binary snapshot layout
+void encode_binary_snapshot(const TaskStore& tasks, std::string& out) {
+    const CategoryDictionary& dictionary = tasks.categories();
+    size_t count = 0;
+    size_t heap_size = 0;
+    for (uint32_t c = 0; c < dictionary.size(); c++) {
+        heap_size += dictionary.name(c).size();
+    }
+    for (const TaskView t : tasks) {
+        count++;
+        heap_size += t.description.size();
+    }
+
+    const size_t records_size = count * sizeof(BinaryTaskRecord);
+    const size_t dictionary_size = dictionary.size() * sizeof(BinaryCategory);
+    out.assign(sizeof(BinaryHeader) + records_size + dictionary_size + heap_size, '\0');
+
+    BinaryHeader header{};
+    std::memcpy(header.magic, kBinaryMagic, sizeof(header.magic));
+    header.version = kBinaryVersion;
+    header.record_size = sizeof(BinaryTaskRecord);
+    header.count = count;
+    header.heap_size = heap_size;
+    header.category_count = static_cast<uint32_t>(dictionary.size());
+    std::memcpy(&out[0], &header, sizeof(header));
+
+    char* records = &out[sizeof(BinaryHeader)];
+    char* categories = records + records_size;
+    char* heap = categories + dictionary_size;
+    uint64_t heap_pos = 0;
+    for (uint32_t c = 0; c < dictionary.size(); c++) {
+        const std::string_view name = dictionary.name(c);
+        const BinaryCategory entry{heap_pos, static_cast<uint32_t>(name.size()), 0};
+        std::memcpy(categories + c * sizeof(BinaryCategory), &entry, sizeof(entry));
+        std::memcpy(heap + heap_pos, name.data(), name.size());
+        heap_pos += name.size();
+    }
+
+    size_t i = 0;
+    for (size_t slot = 0; slot < tasks.size(); slot++) {
+        if (!tasks.is_live(slot)) continue;
+        const TaskView t = tasks[slot];
+        BinaryTaskRecord rec{};
+        rec.id = t.id;
+        rec.completed = t.completed;
+        rec.priority = static_cast<uint8_t>(t.priority);
+        rec.category = tasks.category_id(slot);
+        rec.created_at = t.created_at;
+        rec.due_date = t.due_date;
+        rec.description_offset = heap_pos;
+        rec.description_length = static_cast<uint32_t>(t.description.size());
+        std::memcpy(heap + heap_pos, t.description.data(), t.description.size());
+        heap_pos += t.description.size();
+        std::memcpy(records + i++ * sizeof(BinaryTaskRecord), &rec, sizeof(rec));
+    }
+}
+
+// Read-only mmap of a binary snapshot; records are read in place and strings
+// are handed out as string_views into the mapping.
+class MappedTaskFile {
+public:
+    explicit MappedTaskFile(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return;
+        }
+        struct stat st{};
+        if (::fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(BinaryHeader)) {
+            length = static_cast<size_t>(st.st_size);
+            void* addr = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            base = (addr == MAP_FAILED) ? nullptr : static_cast<const char*>(addr);
+        }
+        ::close(fd);
+        if (base && !validate()) {
+            unmap();
+        }
+    }
+
+    ~MappedTaskFile() {
+        unmap();
+    }
+
+    MappedTaskFile(const MappedTaskFile&) = delete;
+    MappedTaskFile& operator=(const MappedTaskFile&) = delete;
+
+    bool is_open() const { return base != nullptr; }
+    size_t size() const { return count; }
+    size_t heap_size() const { return length - static_cast<size_t>(heap - base); }
+
+    TaskView operator[](size_t i) const {
+        const BinaryTaskRecord rec = record(i);
+        return TaskView{rec.id,
+                        std::string_view(heap + rec.description_offset, rec.description_length),
+                        rec.completed != 0,
+                        static_cast<Priority>(rec.priority),
+                        category_name(rec.category),
+                        rec.created_at,
+                        rec.due_date};
+    }
+
+    uint32_t category_id(size_t i) const { return record(i).category; }
+    int64_t due_date(size_t i) const { return record(i).due_date; }
+    bool is_completed(size_t i) const { return record(i).completed != 0; }
+    Priority priority(size_t i) const { return static_cast<Priority>(record(i).priority); }
+
+    // Dictionary index of a category name, if any task uses it
+    std::optional<uint32_t> find_category(std::string_view name) const {
+        for (uint32_t c = 0; c < category_count; c++) {
+            if (category_name(c) == name) return c;
+        }
+        return std::nullopt;
+    }
+
+    // Cheap format sniff so callers can pick a loader without mapping the file
+    static bool is_binary(const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        char magic[sizeof(kBinaryMagic)] = {};
+        return file.read(magic, sizeof(magic)) && std::memcmp(magic, kBinaryMagic, sizeof(magic)) == 0;
+    }
+
+private:
+    const char* base = nullptr;
+    const char* categories = nullptr;
+    const char* heap = nullptr;
+    size_t length = 0;
+    size_t count = 0;
+    uint32_t category_count = 0;
+
+    BinaryTaskRecord record(size_t i) const {
+        BinaryTaskRecord rec;
+        std::memcpy(&rec, base + sizeof(BinaryHeader) + i * sizeof(BinaryTaskRecord), sizeof(rec));
+        return rec;
+    }
+
+    std::string_view category_name(uint32_t c) const {
+        BinaryCategory entry;
+        std::memcpy(&entry, categories + c * sizeof(BinaryCategory), sizeof(entry));
+        return std::string_view(heap + entry.offset, entry.length);
+    }
+
+    bool validate() {
+        BinaryHeader header;
+        std::memcpy(&header, base, sizeof(header));
+        if (std::memcmp(header.magic, kBinaryMagic, sizeof(header.magic)) != 0 ||
+            header.record_size != sizeof(BinaryTaskRecord) ||
+            header.count > (length - sizeof(BinaryHeader)) / sizeof(BinaryTaskRecord)) {
+            std::cerr << "Error: Malformed binary tasks file.\n";
+            return false;
+        }
+        if (header.version != kBinaryVersion) {
+            std::cerr << "Error: Unsupported binary tasks file version " << header.version << ".\n";
+            return false;
+        }
+        const size_t categories_start = sizeof(BinaryHeader) + header.count * sizeof(BinaryTaskRecord);
+        if (header.category_count > (length - categories_start) / sizeof(BinaryCategory)) {
+            std::cerr << "Error: Malformed binary tasks file.\n";
+            return false;
+        }
+        const size_t heap_start = categories_start + header.category_count * sizeof(BinaryCategory);
+        if (header.heap_size != length - heap_start) {
+            std::cerr << "Error: Truncated binary tasks file.\n";
+            return false;
+        }
+        count = header.count;
+        category_count = header.category_count;
+        categories = base + categories_start;
+        heap = base + heap_start;
+        for (uint32_t c = 0; c < category_count; c++) {
+            BinaryCategory entry;
+            std::memcpy(&entry, categories + c * sizeof(BinaryCategory), sizeof(entry));
+            if (entry.offset > header.heap_size || entry.length > header.heap_size - entry.offset) {
+                std::cerr << "Error: Corrupt category " << c << " in binary tasks file.\n";
+                return false;
+            }
+        }
+        for (size_t i = 0; i < count; i++) {
+            const BinaryTaskRecord rec = record(i);
+            if (rec.description_offset > header.heap_size ||
+                rec.description_length > header.heap_size - rec.description_offset ||
+                rec.category >= category_count || rec.priority > 2) {
+                std::cerr << "Error: Corrupt record " << i << " in binary tasks file.\n";
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void unmap() {
+        if (base) {
+            ::munmap(const_cast<char*>(base), length);
+            base = nullptr;
+        }
+    }
+};
+
+// Full-text search: lower-cased alphanumeric runs of the description are
+// tokens. Bytes >= 0x80 count as word characters so UTF-8 words survive.
+template <typename Fn>
+void for_each_token(std::string_view text, Fn fn) {
+    std::string token;
+    for (char ch : text) {
+        const auto c = static_cast<unsigned char>(ch);
+        if (std::isalnum(c) || c >= 0x80) {
+            token += static_cast<char>(std::tolower(c));
+        } else if (!token.empty()) {
+            fn(token);
+            token.clear();
+        }
+    }
+    if (!token.empty()) {
+        fn(token);
+    }
+}
+
+inline void put_varint(std::string& out, uint32_t v) {
+    while (v >= 0x80) {
+        out += static_cast<char>(v | 0x80);
+        v >>= 7;
+    }
+    out += static_cast<char>(v);
+}
+
+// Decodes one varint at pos; false on a truncated or oversized value
+inline bool get_varint(std::string_view in, size_t& pos, uint32_t& v) {
+    v = 0;
+    for (unsigned shift = 0; shift < 35 && pos < in.size(); shift += 7) {
+        const auto byte = static_cast<uint8_t>(in[pos++]);
+        v |= static_cast<uint32_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+// Ascending task ids stored as varint deltas. A skip entry every
+// kSkipInterval postings lets an intersection jump whole blocks instead of
+// decoding them.
+class PostingList {
+public:
+    static constexpr uint32_t kSkipInterval = 128;
+
+    // Forward-only reader over a list
+    class Cursor {
+    public:
+        explicit Cursor(const PostingList& list) : list(&list) {}
+
+        // Step to the next posting; false once the list is exhausted
+        bool next() {
+            uint32_t delta;
+            if (decoded == list->count || !get_varint(list->bytes, pos, delta)) return false;
+            current += static_cast<int>(delta);
+            decoded++;
+            return true;
+        }
+
+        // Step to the first posting >= target; false if there is none
+        bool seek(int target) {
+            if (decoded > 0 && current >= target) return true;
+            // Last block whose preceding id is below target: every earlier id is too
+            auto block = std::lower_bound(list->skips.begin(), list->skips.end(), target,
+                [](const Skip& skip, int t) { return skip.prev < t; });
+            if (block != list->skips.begin()) {
+                const size_t b = static_cast<size_t>(block - list->skips.begin()) - 1;
+                if (b * kSkipInterval > decoded) {
+                    pos = list->skips[b].offset;
+                    current = list->skips[b].prev;
+                    decoded = static_cast<uint32_t>(b * kSkipInterval);
+                }
+            }
+            while (next()) {
+                if (current >= target) return true;
+            }
+            return false;
+        }
+
+        int value() const { return current; }
+
+    private:
+        const PostingList* list;
+        size_t pos = 0;
+        uint32_t decoded = 0;
+        int current = 0;
+    };
+
+    // Ids must arrive in ascending order; anything else takes the slow path
+    void append(int id) {
+        if (count > 0 && id <= last) {
+            insert_out_of_order(id);
+            return;
+        }
+        if (count % kSkipInterval == 0) {
+            skips.push_back({last, static_cast<uint32_t>(bytes.size())});
+        }
+        put_varint(bytes, static_cast<uint32_t>(id - last));
+        last = id;
+        count++;
+    }
+
+    uint32_t size() const { return count; }
+    const std::string& data() const { return bytes; }
+
+    std::vector<int> decode() const {
+        std::vector<int> ids;
+        ids.reserve(count);
+        Cursor cursor(*this);
+        while (cursor.next()) ids.push_back(cursor.value());
+        return ids;
+    }
+
+    // The list minus the ids in dead
+    PostingList without(const std::unordered_set<int>& dead) const {
+        PostingList kept;
+        Cursor cursor(*this);
+        while (cursor.next()) {
+            if (!dead.count(cursor.value())) kept.append(cursor.value());
+        }
+        return kept;
+    }
+
+    // Rebuild a list from persisted bytes, rejecting anything malformed
+    static bool restore(std::string_view data, uint32_t count, PostingList& out) {
+        out = PostingList();
+        size_t pos = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t delta;
+            if (!get_varint(data, pos, delta) || delta == 0 ||
+                delta > static_cast<uint32_t>(INT32_MAX - out.last)) {
+                return false;
+            }
+            out.append(out.last + static_cast<int>(delta));
+        }
+        return pos == data.size();
+    }
+
+private:
+    struct Skip {
+        int prev;         // id decoded just before the block (0 for the first)
+        uint32_t offset;  // byte offset of the block's first delta
+    };
+
+    std::string bytes;
+    std::vector<Skip> skips;
+    int last = 0;
+    uint32_t count = 0;
+
+    void insert_out_of_order(int id) {
+        std::vector<int> ids = decode();
+        auto it = std::lower_bound(ids.begin(), ids.end(), id);
+        if (it != ids.end() && *it == id) return;
+        ids.insert(it, id);
+        *this = PostingList();
+        for (int each : ids) append(each);
+    }
+};
+
+// Ids present in every list, ascending. The rarest list drives; the others
+// are probed through skip-assisted cursors.
+std::vector<int> intersect_postings(std::vector<const PostingList*> lists) {
+    std::vector<int> result;
+    if (lists.empty()) {
+        return result;
+    }
+    std::sort(lists.begin(), lists.end(),
+        [](const PostingList* a, const PostingList* b) { return a->size() < b->size(); });
+
+    std::vector<PostingList::Cursor> cursors;
+    for (size_t i = 1; i < lists.size(); i++) {
+        cursors.emplace_back(*lists[i]);
+    }
+    PostingList::Cursor driver(*lists[0]);
+    while (driver.next()) {
+        const int id = driver.value();
+        bool all = true;
+        for (auto& cursor : cursors) {
+            if (!cursor.seek(id)) {
+                return result;
+            }
+            if (cursor.value() != id) {
+                all = false;
+                break;
+            }
+        }
+        if (all) {
+            result.push_back(id);
+        }
+    }
+    return result;
+}
+
+// Deletes from the text indexes are lazy: removed ids collect in a dead set
+// that lookups filter out until purge_postings rewrites the lists without them
+void drop_dead(std::vector<int>& ids, const std::unordered_set<int>& dead) {
+    if (!dead.empty()) {
+        ids.erase(std::remove_if(ids.begin(), ids.end(), [&dead](int id) { return dead.count(id) > 0; }), ids.end());
+    }
+}
+
+// Rewrite every list of postings without the dead ids, dropping lists left empty
+template <typename Postings>
+void purge_postings(Postings& postings, const std::unordered_set<int>& dead) {
+    for (auto it = postings.begin(); it != postings.end();) {
+        PostingList kept = it->second.without(dead);
+        if (kept.size() == 0) {
+            it = postings.erase(it);
+        } else {
+            it->second = std::move(kept);
+            ++it;
+        }
+    }
+}
+
+// Size and mtime of the snapshot an index was built against
+struct SnapshotStamp {
+    uint64_t size = 0;
+    int64_t mtime_ns = 0;
+
+    bool operator==(const SnapshotStamp& other) const {
+        return size == other.size && mtime_ns == other.mtime_ns;
+    }
+};
+
+std::optional<SnapshotStamp> snapshot_stamp(const std::string& path) {
+    struct stat st{};
+    if (::stat(path.c_str(), &st) != 0) {
+        return std::nullopt;
+    }
+    return SnapshotStamp{static_cast<uint64_t>(st.st_size),
+                         static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec};
+}
+
+// Token -> posting list index over task descriptions. Deletes are lazy:
+// removed ids are filtered from results and dropped from the lists by
+// purge(), which runs before the index is persisted.
+//
+// Sidecar layout (host-endian, like the binary snapshot): magic, u32
+// version, u32 term count, the SnapshotStamp of the tasks file, then per
+// term u32 term length, u32 posting count, u32 byte length, term bytes and
+// posting bytes.
+class InvertedIndex {
+public:
+    void add(int id, std::string_view text) {
+        std::vector<std::string> terms;
+        for_each_token(text, [&terms](const std::string& token) { terms.push_back(token); });
+        std::sort(terms.begin(), terms.end());
+        terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+        for (const auto& term : terms) {
+            postings[term].append(id);
+        }
+    }
+
+    void remove(int id) {
+        dead.insert(id);
+    }
+
+    void clear() {
+        postings.clear();
+        dead.clear();
+    }
+
+    size_t term_count() const { return postings.size(); }
+
+    // Ids whose description holds every query term, ascending
+    std::vector<int> search(std::string_view query) const {
+        std::vector<const PostingList*> lists;
+        bool missing = false;
+        for_each_token(query, [&](const std::string& token) {
+            auto it = postings.find(token);
+            if (it == postings.end()) {
+                missing = true;
+            } else if (std::find(lists.begin(), lists.end(), &it->second) == lists.end()) {
+                lists.push_back(&it->second);
+            }
+        });
+        if (missing) {
+            return {};
+        }
+        std::vector<int> result = intersect_postings(lists);
+        drop_dead(result, dead);
+        return result;
+    }
+
+    // Rewrite the lists without removed ids
+    void purge() {
+        if (dead.empty()) {
+            return;
+        }
+        purge_postings(postings, dead);
+        dead.clear();
+    }
+
+    void encode(const SnapshotStamp& stamp, std::string& out) const {
+        out.assign(kIndexMagic, sizeof(kIndexMagic));
+        put_u32(out, kIndexVersion);
+        put_u32(out, static_cast<uint32_t>(postings.size()));
+        out.append(reinterpret_cast<const char*>(&stamp), sizeof(stamp));
+        for (const auto& [term, list] : postings) {
+            put_u32(out, static_cast<uint32_t>(term.size()));
+            put_u32(out, list.size());
+            put_u32(out, static_cast<uint32_t>(list.data().size()));
+            out += term;
+            out += list.data();
+        }
+    }
+
+    // Load a sidecar built against stamp; false if it is missing, stale or corrupt
+    bool decode(std::string_view in, const SnapshotStamp& stamp) {
+        clear();
+        size_t pos = sizeof(kIndexMagic);
+        uint32_t version, terms;
+        SnapshotStamp built;
+        if (in.size() < pos || std::memcmp(in.data(), kIndexMagic, sizeof(kIndexMagic)) != 0 ||
+            !get_u32(in, pos, version) || version != kIndexVersion || !get_u32(in, pos, terms) ||
+            in.size() - pos < sizeof(built)) {
+            return false;
+        }
+        std::memcpy(&built, in.data() + pos, sizeof(built));
+        pos += sizeof(built);
+        if (!(built == stamp)) {
+            return false;
+        }
+        postings.reserve(terms);
+        for (uint32_t t = 0; t < terms; t++) {
+            uint32_t term_len, count, byte_len;
+            if (!get_u32(in, pos, term_len) || !get_u32(in, pos, count) || !get_u32(in, pos, byte_len) ||
+                in.size() - pos < static_cast<size_t>(term_len) + byte_len ||
+                !PostingList::restore(in.substr(pos + term_len, byte_len), count,
+                                      postings[std::string(in.substr(pos, term_len))])) {
+                clear();
+                return false;
+            }
+            pos += static_cast<size_t>(term_len) + byte_len;
+        }
+        if (pos != in.size()) {
+            clear();
+            return false;
+        }
+        return true;
+    }
+
+private:
+    static constexpr char kIndexMagic[8] = {'T', 'A', 'S', 'K', 'I', 'D', 'X', '1'};
+    static constexpr uint32_t kIndexVersion = 1;
+
+    std::unordered_map<std::string, PostingList> postings;
+    std::unordered_set<int> dead;
+
+    static void put_u32(std::string& out, uint32_t v) {
+        out.append(reinterpret_cast<const char*>(&v), sizeof(v));
+    }
+
+    static bool get_u32(std::string_view in, size_t& pos, uint32_t& v) {
+        if (in.size() - pos < sizeof(v)) return false;
+        std::memcpy(&v, in.data() + pos, sizeof(v));
+        pos += sizeof(v);
+        return true;
+    }
+};
+
+// Substring search: every 3-byte window of a description is a trigram, and
+// each trigram maps to the ids whose description contains it. A match must
+// contain all of the pattern's trigrams, so intersecting their lists gives a
+// candidate set the caller confirms with an exact find(). Patterns shorter
+// than three bytes cannot be narrowed. Matching is case-sensitive.
+class TrigramIndex {
+public:
+    void add(int id, std::string_view text) {
+        for (uint32_t gram : trigrams_of(text)) {
+            postings[gram].append(id);
+        }
+        documents++;
+    }
+
+    // Lazy like InvertedIndex; the lists are rewritten once half the ids are gone
+    void remove(int id) {
+        dead.insert(id);
+        if (dead.size() * 2 > documents) {
+            purge();
+        }
+    }
+
+    void clear() {
+        postings.clear();
+        dead.clear();
+        documents = 0;
+    }
+
+    size_t trigram_count() const { return postings.size(); }
+
+    // Ascending ids that may contain pattern; nullopt when the pattern is too
+    // short to narrow anything and every task is a candidate
+    std::optional<std::vector<int>> candidates(std::string_view pattern) const {
+        if (pattern.size() < 3) {
+            return std::nullopt;
+        }
+        std::vector<const PostingList*> lists;
+        for (uint32_t gram : trigrams_of(pattern)) {
+            auto it = postings.find(gram);
+            if (it == postings.end()) {
+                return std::vector<int>();
+            }
+            lists.push_back(&it->second);
+        }
+        std::vector<int> ids = intersect_postings(std::move(lists));
+        drop_dead(ids, dead);
+        return ids;
+    }
+
+private:
+    std::unordered_map<uint32_t, PostingList> postings;
+    std::unordered_set<int> dead;
+    size_t documents = 0;
+
+    // Distinct trigrams of text, each packed into the low 24 bits
+    static std::vector<uint32_t> trigrams_of(std::string_view text) {
+        std::vector<uint32_t> grams;
+        if (text.size() < 3) {
+            return grams;
+        }
+        grams.reserve(text.size() - 2);
+        uint32_t window = (static_cast<uint8_t>(text[0]) << 8) | static_cast<uint8_t>(text[1]);
+        for (size_t i = 2; i < text.size(); i++) {
+            window = ((window << 8) | static_cast<uint8_t>(text[i])) & 0xffffff;
+            grams.push_back(window);
+        }
+        std::sort(grams.begin(), grams.end());
+        grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+        return grams;
+    }
+
+    void purge() {
+        purge_postings(postings, dead);
+        documents -= dead.size();
+        dead.clear();
+    }
+};
+
+// Cross-process advisory lock held around a load/save cycle
+enum class LockMode {
+    None,       // no locking (in-process use, tests)
+    Shared,     // readers: any number may hold it together
+    Exclusive   // writers: excludes readers and other writers
+};
+
+// flock() on a sidecar <file>.lock. The tasks file itself is not locked
+// because saves may replace it, which would orphan a lock on the old inode.
+class FileLock {
+public:
+    FileLock() = default;
+
+    ~FileLock() {
+        release();
+    }
+
+    FileLock(const FileLock&) = delete;
+    FileLock& operator=(const FileLock&) = delete;
+
+    // Blocks until the lock is granted; false if the lock file is unusable
+    bool acquire(const std::string& path, LockMode mode) {
+        release();
+        if (mode == LockMode::None) {
+            return true;
+        }
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            std::cerr << "Warning: Could not open lock file " << path << ": " << std::strerror(errno) << "\n";
+            return false;
+        }
+        const int op = mode == LockMode::Shared ? LOCK_SH : LOCK_EX;
+        while (::flock(fd, op) != 0) {
+            if (errno != EINTR) {
+                std::cerr << "Warning: Could not lock " << path << ": " << std::strerror(errno) << "\n";
+                release();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void release() {
+        if (fd >= 0) {
+            ::close(fd);  // closing the descriptor drops the flock
+            fd = -1;
+        }
+    }
+
+private:
+    int fd = -1;
+};
+
+// How hard TaskManager works to make each mutation survive a crash
+enum class Durability {
+    None,   // never fsync; the kernel writes back when it likes
+    Batch,  // group commit: fsync once per N mutations or N milliseconds
+    Sync    // fsync every mutation before returning
+};
+
+// Decides which persisted mutations must be synced and counts the syncs done
+class SyncPolicy {
+public:
+    Durability mode = Durability::None;
+    size_t group_ops = 64;
+    milliseconds group_interval{50};
+
+    // Called once per persisted mutation; true when this one has to be synced
+    bool due() {
+        if (mode == Durability::None) return false;
+        if (mode == Durability::Sync) return true;
+        pending++;
+        return pending >= group_ops || steady_clock::now() - last_sync >= group_interval;
+    }
+
+    void synced() {
+        syncs++;
+        pending = 0;
+        last_sync = steady_clock::now();
+    }
+
+    // Mutations written since the last sync
+    size_t unsynced() const { return pending; }
+    size_t sync_count() const { return syncs; }
+
+private:
+    size_t pending = 0;
+    size_t syncs = 0;
+    steady_clock::time_point last_sync = steady_clock::now();
+};
+
+Durability parse_durability(const std::string& s) {
+    if (s == "batch") return Durability::Batch;
+    if (s == "fsync") return Durability::Sync;
+    return Durability::None;
+}
+
+std::string durability_to_string(Durability d) {
+    switch (d) {
+        case Durability::Batch: return "batch";
+        case Durability::Sync: return "fsync";
+        default: return "none";
+    }
+}
+
+// How TaskManager persists mutations
+enum class StorageMode {
+    Snapshot,  // rewrite the whole tasks file after every mutation
+    Wal        // append one record per mutation to <file>.log, replayed on load
+};
+
+void run_tests();
+
+// TaskManager class with enhanced functionality
+class TaskManager {
+    friend void run_tests();
+
+public:
+    TaskManager(const std::string& fp, StorageMode mode = StorageMode::Snapshot, LockMode lock = LockMode::None)
+        : next_id(1), file_path(fp), log_path(fp + ".log"), sealed_log_path(fp + ".log.1"),
+          index_path(fp + ".idx"), storage_mode(mode) {
+        // Held for the manager's lifetime so load -> mutate -> save is atomic across processes
+        file_lock.acquire(fp + ".lock", lock);
+        load_tasks();
+    }
+
+    TaskManager(const TaskManager&) = delete;
+    TaskManager& operator=(const TaskManager&) = delete;
+
+    // Wait for any in-flight compaction so the snapshot is never left half-published,
+    // and close out a pending group commit
+    ~TaskManager() {
+        wait_for_compaction();
+        sync_pending();
+        if (log_fd >= 0) {
+            ::close(log_fd);
+        }
+    }
+
+    // Add a new task with priority and category
+    void add_task(const std::string& desc, const std::optional<std::string>& due,
+                  Priority pri, const std::string& cat) {
+        Task task(next_id, desc, pri, cat);
+        if (due && !parse_fixed_timestamp(*due, false, task.due_date)) {
+            std::istringstream iss(*due);
+            system_clock::time_point tp;
+            iss >> date::parse("%Y-%m-%d", tp);
+            if (!iss.fail()) {
+                task.set_due_time(tp);
+            } else {
+                std::cerr << "Warning: Invalid due date format, ignoring due date.\n";
+            }
+        }
+
+        id_index[next_id] = tasks.size();
+        tasks.push_back(task);
+        index_due(tasks.size() - 1);
+        search_index.add(next_id, desc);
+        if (substring_index_built) {
+            substring_index.add(next_id, desc);
+        }
+        std::cout << "Task added with ID " << next_id << "\n";
+        next_id++;
+        persist({{"op", "add"}, {"task", task}});
+    }
+
+    // List tasks with sorting option
+    void list_tasks(const ListOptions& opts) const {
+        bool presorted = false;
+        const QueryPlan plan = plan_query(opts);
+        std::vector<SortEntry> order = run_plan(plan, opts, presorted);
+        if (opts.explain) {
+            print_query_plan(plan, order.size());
+        }
+        render_task_list(order,
+            [this](uint32_t slot) { return tasks[slot]; },
+            [this](uint32_t slot, SortBy by) { return tasks.sort_key(slot, by); }, opts, presorted);
+    }
+
+    // Tasks whose description contains every term of query (or, with
+    // substring, the query itself), narrowed by the same filters list takes
+    void search_tasks(const std::string& query, const ListOptions& opts, bool substring = false) const {
+        std::vector<SortEntry> order;
+        const auto category = opts.category ? tasks.categories().find(*opts.category) : std::nullopt;
+        auto consider = [&](size_t slot) {
+            if ((!category || tasks.category_id(slot) == *category) &&
+                opts.flags_match(tasks.priority(slot), tasks.is_completed(slot)) &&
+                (!opts.filters_due() || opts.due_in_range(tasks.due_date(slot))) &&
+                (!opts.where || opts.where->matches(tasks[slot])) &&
+                (!substring || tasks[slot].description.find(query) != std::string_view::npos)) {
+                order.push_back({0, static_cast<uint32_t>(slot)});
+            }
+        };
+
+        if (!opts.category || category) {
+            const auto ids = substring ? substring_candidates(query) : std::make_optional(search_index.search(query));
+            if (ids) {
+                for (int id : *ids) {
+                    if (auto slot = find_slot(id)) consider(*slot);
+                }
+            } else {
+                for (size_t slot = 0; slot < tasks.size(); slot++) {
+                    if (tasks.is_live(slot)) consider(slot);
+                }
+            }
+        }
+        std::sort(order.begin(), order.end());  // file order, as list shows it
+        render_task_list(order,
+            [this](uint32_t slot) { return tasks[slot]; },
+            [this](uint32_t slot, SortBy by) { return tasks.sort_key(slot, by); }, opts);
+    }
+
+    // List straight from a mapped binary snapshot without materializing tasks.
+    // Returns false when the file is not binary or a log still has to be replayed.
+    static bool list_mapped(const std::string& fp, const ListOptions& opts) {
+        FileLock lock;
+        lock.acquire(fp + ".lock", LockMode::Shared);
+        if (!MappedTaskFile::is_binary(fp) || fs::exists(fp + ".log") || fs::exists(fp + ".log.1")) {
+            return false;
+        }
+        MappedTaskFile mapped(fp);
+        if (!mapped.is_open()) {
+            return false;
+        }
+        std::vector<SortEntry> order;
+        const auto category = opts.category ? mapped.find_category(*opts.category) : std::nullopt;
+        if (!opts.category || category) {
+            order.reserve(mapped.size());
+            for (size_t i = 0; i < mapped.size(); i++) {
+                if ((!category || mapped.category_id(i) == *category) &&
+                    (!opts.filters_due() || opts.due_in_range(mapped.due_date(i))) &&
+                    opts.flags_match(mapped.priority(i), mapped.is_completed(i)) &&
+                    (!opts.where || opts.where->matches(mapped[i]))) {
+                    order.push_back({0, static_cast<uint32_t>(i)});
+                }
+            }
+        }
+        render_task_list(order,
+            [&mapped](uint32_t i) { return mapped[i]; },
+            [&mapped](uint32_t i, SortBy by) { return sort_key(mapped[i], by); }, opts);
+        return true;
+    }
+
+    // Mark a task as complete
+    void complete_task(int id) {
+        if (auto slot = find_slot(id)) {
+            tasks.set_completed(*slot);
+            std::cout << "Task " << id << " marked as complete.\n";
+            persist({{"op", "complete"}, {"id", id}});
+        } else {
+            std::cout << "Task with ID " << id << " not found.\n";
+        }
+    }
+
+    // Delete a task
+    void delete_task(int id) {
+        if (find_slot(id)) {
+            retire_task(id);
+            std::cout << "Task " << id << " deleted.\n";
+            persist({{"op", "delete"}, {"id", id}});
+        } else {
+            std::cout << "Task with ID " << id << " not found.\n";
+        }
+    }
+
+    // Clear all tasks
+    void clear_tasks() {
+        tasks.clear();
+        id_index.clear();
+        due_index.clear();
+        search_index.clear();
+        substring_index.clear();
+        tombstones = 0;
+        next_id = 1;
+        std::cout << "All tasks cleared.\n";
+        persist({{"op", "clear"}});
+    }
+
+    // Fold the write-ahead log into a fresh snapshot and drop the log
+    void checkpoint() {
+        wait_for_compaction();
+        save_tasks();
+    }
+
+    // Log size / record count past which the log is compacted in the background
+    void set_compaction_threshold(uintmax_t max_bytes, size_t max_records) {
+        compact_log_bytes = max_bytes;
+        compact_log_records = max_records;
+    }
+
+    // Encoding used for the next snapshot write; defaults to whatever was loaded
+    void set_snapshot_format(SnapshotFormat format) {
+        snapshot_format = format;
+    }
+
+    SnapshotFormat format() const {
+        return snapshot_format;
+    }
+
+    // Hold snapshot rewrites until flush() instead of saving after every mutation
+    void set_deferred_saves(bool deferred) {
+        defer_saves = deferred;
+    }
+
+    // Write out a snapshot deferred by set_deferred_saves()
+    void flush() {
+        if (dirty) {
+            save_tasks();
+        }
+    }
+
+    // Choose the fsync policy; group_ops / group_interval only apply to Batch
+    void set_durability(Durability mode, size_t group_ops = 64, milliseconds group_interval = milliseconds(50)) {
+        sync_policy.mode = mode;
+        sync_policy.group_ops = std::max<size_t>(group_ops, 1);
+        sync_policy.group_interval = group_interval;
+    }
+
+    Durability durability() const {
+        return sync_policy.mode;
+    }
+
+    milliseconds group_commit_interval() const {
+        return sync_policy.group_interval;
+    }
+
+    // Number of fsync commits performed so far
+    size_t sync_count() const {
+        return sync_policy.sync_count();
+    }
+
+    // True when a group commit is holding unsynced mutations
+    bool has_unsynced() const {
+        return sync_policy.unsynced() > 0;
+    }
+
+    // Force out mutations a group commit has not synced yet
+    void sync_pending() {
+        if (!has_unsynced()) {
+            return;
+        }
+        if (log_fd >= 0) {
+            ::fdatasync(log_fd);
+        } else {
+            sync_file(file_path);
+            sync_parent_dir(file_path);
+        }
+        sync_policy.synced();
+    }
+
+    // Write JSON snapshots without indentation
+    void set_compact_json(bool compact) {
+        compact_json = compact;
+    }
+
+    bool compacts_json() const {
+        return compact_json;
+    }
+
+    // Block until a running background compaction has published its snapshot
+    void wait_for_compaction() {
+        if (compactor.joinable()) {
+            compactor.join();
+        }
+    }
+
+private:
+    FileLock file_lock;  // declared first so it is released last
+    TaskStore tasks;
+    std::unordered_map<int, size_t> id_index;  // id -> slot in tasks
+    std::set<std::pair<int64_t, int>> due_index;  // (due date, id) for tasks that have one
+    InvertedIndex search_index;                   // description tokens -> ids
+    mutable TrigramIndex substring_index;         // built by the first substring search
+    mutable bool substring_index_built = false;
+    size_t tombstones = 0;                     // deleted slots awaiting compaction
+    int next_id;
+    std::string file_path;
+    std::string log_path;
+    std::string sealed_log_path;
+    std::string index_path;  // persisted search index, valid for one snapshot
+    StorageMode storage_mode;
+    SnapshotFormat snapshot_format = SnapshotFormat::Json;
+    bool compact_json = false;
+    SyncPolicy sync_policy;
+    bool defer_saves = false;
+    bool dirty = false;  // a deferred snapshot write is pending
+    std::string write_buffer;  // reused across saves to avoid regrowing
+    int log_fd = -1;  // O_APPEND descriptor for the active log
+    uintmax_t log_bytes = 0;
+    size_t log_records = 0;
+    uintmax_t compact_log_bytes = 4 * 1024 * 1024;
+    size_t compact_log_records = 10000;
+    bool sealed_log_pending = false;
+    std::thread compactor;
+    std::atomic<bool> compacting{false};
+
+    // Fold-only instance used by the compactor: snapshot plus sealed segment, no active log
+    struct FoldTag {};
+    TaskManager(FoldTag, const std::string& fp)
+        : next_id(1), file_path(fp), log_path(fp + ".log"), sealed_log_path(fp + ".log.1"),
+          index_path(fp + ".idx"), storage_mode(StorageMode::Snapshot) {
+        load_snapshot();
+        replay_log(sealed_log_path);
+    }
+
+    std::optional<size_t> find_slot(int id) const {
+        auto it = id_index.find(id);
+        if (it == id_index.end()) {
+            return std::nullopt;
+        }
+        return it->second;
+    }
+
+    // Turn a live task into a tombstone instead of shifting the columns;
+    // its strings stay in the heap until the next compaction
+    void retire_task(int id) {
+        auto it = id_index.find(id);
+        unindex_due(it->second);
+        search_index.remove(id);
+        if (substring_index_built) {
+            substring_index.remove(id);
+        }
+        tasks.retire(it->second);
+        id_index.erase(it);
+        tombstones++;
+        if (tombstones > tasks.size() / 2) {
+            compact_slots();
+        }
+    }
+
+    // Squeeze tombstones out of the columns and renumber the index
+    void compact_slots() {
+        if (tombstones == 0) {
+            return;
+        }
+        tasks.compact();
+        tombstones = 0;
+        rebuild_index();
+    }
+
+    void rebuild_index() {
+        id_index.clear();
+        id_index.reserve(tasks.size());
+        for (size_t slot = 0; slot < tasks.size(); slot++) {
+            id_index[tasks.id(slot)] = slot;
+        }
+    }
+
+    // Ids never change, so the due-date index only needs a rebuild after a load
+    void rebuild_due_index() {
+        due_index.clear();
+        for (size_t slot = 0; slot < tasks.size(); slot++) {
+            index_due(slot);
+        }
+    }
+
+    void index_due(size_t slot) {
+        if (tasks.is_live(slot) && tasks.due_date(slot) != kNoDueDate) {
+            due_index.emplace(tasks.due_date(slot), tasks.id(slot));
+        }
+    }
+
+    void unindex_due(size_t slot) {
+        due_index.erase({tasks.due_date(slot), tasks.id(slot)});
+    }
+
+    // Use the sidecar index when it was built against this snapshot,
+    // otherwise tokenize every description again
+    void load_search_index() {
+        const auto stamp = snapshot_stamp(file_path);
+        std::ifstream file(index_path, std::ios::binary);
+        if (stamp && file.is_open()) {
+            const std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            if (search_index.decode(data, *stamp)) {
+                return;
+            }
+        }
+        search_index.clear();
+        for (size_t slot = 0; slot < tasks.size(); slot++) {
+            if (tasks.is_live(slot)) {
+                search_index.add(tasks.id(slot), tasks[slot].description);
+            }
+        }
+    }
+
+    // Persist the search index next to the snapshot that was just published
+    void save_search_index() {
+        const auto stamp = snapshot_stamp(file_path);
+        if (!stamp) {
+            return;
+        }
+        search_index.purge();
+        std::string data;
+        search_index.encode(*stamp, data);
+        const std::string tmp_path = index_path + ".tmp";
+        std::error_code ec;
+        if (!write_whole_file(tmp_path, data) || ::rename(tmp_path.c_str(), index_path.c_str()) != 0) {
+            // Not fatal: a stale or missing index is rebuilt on the next load
+            std::cerr << "Warning: Could not write " << index_path << ".\n";
+            fs::remove(tmp_path, ec);
+        }
+    }
+
+    // Trigram candidates for a substring query, building the index on first use
+    std::optional<std::vector<int>> substring_candidates(std::string_view pattern) const {
+        if (!substring_index_built) {
+            for (size_t slot = 0; slot < tasks.size(); slot++) {
+                if (tasks.is_live(slot)) {
+                    substring_index.add(tasks.id(slot), tasks[slot].description);
+                }
+            }
+            substring_index_built = true;
+        }
+        return substring_index.candidates(pattern);
+    }
+
+    // Planner cost units, each about one row visit in a column scan
+    static constexpr double kScanRowCost = 1.0;     // per slot of a vectorized scan
+    static constexpr double kBitmapRowCost = 0.25;  // per value of each bitmap combined
+    static constexpr double kIndexRowCost = 2.0;    // per row fetched through due_index or id_index
+    static constexpr double kCheckRowCost = 2.0;    // per candidate checked against residual tests
+    static constexpr double kSortRowCost = 1.0;     // per row and comparison level of a sort
+    static constexpr int64_t kMaxIdProbes = 1024;   // longest id range worth probing id_index for
+
+    // Rows a subtree is expected to match, from the column statistics.
+    // && multiplies selectivities as if the columns were independent.
+    double estimate_rows(const FilterExpr& expr, int n) const {
+        using Kind = FilterExpr::Kind;
+        const TaskStore::ColumnStats& st = tasks.stats();
+        const double live = static_cast<double>(st.live);
+        const FilterExpr::Node& x = expr.node(n);
+        double rows = 0;
+        switch (x.kind) {
+            case Kind::Const:
+                return x.value ? live : 0;
+            case Kind::Priority:
+                for (int p = 0; p < 3; p++) {
+                    if ((x.priorities >> p) & 1) rows += st.priority[p];
+                }
+                return rows;
+            case Kind::Completed:
+                return x.value ? st.done : live - st.done;
+            case Kind::Category:
+                for (const auto& name : x.categories) {
+                    const auto id = tasks.categories().find(name);
+                    if (id && *id < st.category.size()) rows += st.category[*id];
+                }
+                return rows;
+            case Kind::Due:
+                return st.due_between(x.lo, x.hi);
+            case Kind::Id: {
+                // Ids are handed out densely, so a range holds its share of the live rows
+                const int64_t hi = std::min<int64_t>(x.hi, next_id);
+                return hi > x.lo && next_id > 1 ? live * (hi - x.lo) / (next_id - 1) : 0;
+            }
+            case Kind::Not:
+                return std::max(0.0, live - estimate_rows(expr, x.children[0]));
+            case Kind::Or:
+                for (int c : x.children) rows += estimate_rows(expr, c);
+                return std::min(live, rows);
+            case Kind::And:
+                rows = live;
+                for (int c : x.children) rows *= live > 0 ? estimate_rows(expr, c) / live : 0;
+                return rows;
+        }
+        return 0;
+    }
+
+    // Cost of answering a subtree from the priority, completion and category
+    // bitmaps alone, or nullopt when it tests another column
+    std::optional<double> bitmap_cost(const FilterExpr& expr, int n) const {
+        using Kind = FilterExpr::Kind;
+        const FilterExpr::Node& x = expr.node(n);
+        switch (x.kind) {
+            case Kind::Const:
+            case Kind::Priority:
+            case Kind::Completed:
+            case Kind::Category:
+                return estimate_rows(expr, n) * kBitmapRowCost;
+            case Kind::Due:
+            case Kind::Id:
+                return std::nullopt;
+            case Kind::Not:
+            case Kind::And:
+            case Kind::Or: {
+                double cost = x.kind == Kind::Not ? tasks.stats().live * kBitmapRowCost : 0;
+                for (int c : x.children) {
+                    const auto inner = bitmap_cost(expr, c);
+                    if (!inner) return std::nullopt;
+                    cost += *inner;
+                }
+                return cost;
+            }
+        }
+        return std::nullopt;
+    }
+
+    // Cost every access path for a listing from the column statistics and
+    // keep the cheapest: a scan of the columns, the bitmaps for the priority,
+    // completion and category tests, or a walk of due_index or id_index over
+    // a due or id range. Tests the chosen path does not answer are checked
+    // row by row on its candidates. Delivering due order for free counts in
+    // the due index's favour.
+    QueryPlan plan_query(const ListOptions& opts) const {
+        using Kind = FilterExpr::Kind;
+        using Access = QueryPlan::Access;
+        QueryPlan plan;
+        plan.filter = opts.filter();
+        const FilterExpr& expr = plan.filter;
+        const FilterExpr::Node& root = expr.node(expr.root());
+        std::vector<int> operands;
+        if (root.kind == Kind::And) {
+            operands = root.children;
+        } else if (root.kind != Kind::Const) {
+            operands.push_back(expr.root());
+        }
+
+        const TaskStore::ColumnStats& st = tasks.stats();
+        const double live = static_cast<double>(st.live);
+        const double rows = estimate_rows(expr, expr.root());
+        plan.estimated_rows = rows;
+        auto sort_cost = [](double n) { return n * std::log2(n + 1) * kSortRowCost; };
+        const double due_sort = opts.sort_by == SortBy::DueDate ? sort_cost(rows) : 0;
+        auto consider = [&](Access access, std::vector<int> answered, double yielded, double cost) {
+            std::vector<int> residual;
+            for (int c : operands) {
+                if (std::find(answered.begin(), answered.end(), c) == answered.end()) residual.push_back(c);
+            }
+            if (!residual.empty()) cost += yielded * kCheckRowCost;
+            plan.considered.push_back({access, yielded, cost});
+            if (plan.considered.size() == 1 || cost < plan.cost) {
+                plan.access = access;
+                plan.answered = std::move(answered);
+                plan.residual = std::move(residual);
+                plan.cost = cost;
+            }
+        };
+
+        consider(Access::Scan, operands, operands.empty() ? live : rows, tasks.size() * kScanRowCost + due_sort);
+
+        std::vector<int> bitmapped;
+        double bitmap_rows = live;
+        double bitmap_work = 0;
+        for (int c : operands) {
+            if (const auto cost = bitmap_cost(expr, c)) {
+                bitmapped.push_back(c);
+                bitmap_rows *= live > 0 ? estimate_rows(expr, c) / live : 0;
+                bitmap_work += *cost;
+            }
+        }
+        if (!bitmapped.empty()) {
+            consider(Access::Bitmaps, bitmapped, bitmap_rows, bitmap_work + due_sort);
+        }
+
+        const auto due = std::find_if(operands.begin(), operands.end(),
+                                      [&](int c) { return expr.node(c).kind == Kind::Due; });
+        if (due != operands.end()) {
+            const double yielded = estimate_rows(expr, *due);
+            const double resort = opts.sort_by == SortBy::Id ? sort_cost(rows) : 0;  // back to file order
+            consider(Access::DueIndex, {*due}, yielded, std::log2(live + 1) + yielded * kIndexRowCost + resort);
+        } else if (opts.sort_by == SortBy::DueDate) {
+            // No due range, but walking the whole index still yields due order
+            const double dated = live - st.undated;
+            consider(Access::DueIndex, {}, live, dated * kIndexRowCost + tasks.size() * kScanRowCost);
+        }
+
+        const auto id = std::find_if(operands.begin(), operands.end(), [&](int c) {
+            return expr.node(c).kind == Kind::Id && expr.node(c).hi - expr.node(c).lo <= kMaxIdProbes;
+        });
+        if (id != operands.end()) {
+            const double probes = std::max<int64_t>(0, std::min<int64_t>(expr.node(*id).hi, next_id) - expr.node(*id).lo);
+            consider(Access::IdIndex, {*id}, estimate_rows(expr, *id), probes * kIndexRowCost + due_sort);
+        }
+        return plan;
+    }
+
+    // Rows of a subtree bitmap_cost accepted, combined from the priority,
+    // completion and category bitmaps
+    RoaringBitmap bitmap_rows(const FilterExpr& expr, int n) const {
+        using Kind = FilterExpr::Kind;
+        const FilterExpr::Node& x = expr.node(n);
+        RoaringBitmap rows;
+        switch (x.kind) {
+            case Kind::Const:
+                return x.value ? tasks.live() : rows;
+            case Kind::Priority:
+                for (int p = 0; p < 3; p++) {
+                    if ((x.priorities >> p) & 1) rows = rows | tasks.with_priority(static_cast<Priority>(p));
+                }
+                return rows;
+            case Kind::Completed:
+                return x.value ? tasks.done() : RoaringBitmap::and_not(tasks.live(), tasks.done());
+            case Kind::Category:
+                for (const auto& name : x.categories) {
+                    if (auto id = tasks.categories().find(name)) rows = rows | tasks.in_category(*id);
+                }
+                return rows;
+            case Kind::Not:
+                return RoaringBitmap::and_not(tasks.live(), bitmap_rows(expr, x.children[0]));
+            case Kind::Or:
+                for (int c : x.children) rows = rows | bitmap_rows(expr, c);
+                return rows;
+            case Kind::And:
+                rows = bitmap_rows(expr, x.children[0]);
+                for (size_t i = 1; i < x.children.size() && !rows.empty(); i++) {
+                    rows = rows & bitmap_rows(expr, x.children[i]);
+                }
+                return rows;
+            case Kind::Due:
+            case Kind::Id:
+                break;  // no bitmap; bitmap_cost turns these subtrees away
+        }
+        return rows;
+    }
+
+    // Pick the slots a listing shows by running its plan. Walking due_index
+    // leaves the rows in due order, and presorted is set when the listing
+    // wants that order; otherwise rows come back in file order.
+    std::vector<SortEntry> run_plan(const QueryPlan& plan, const ListOptions& opts, bool& presorted) const {
+        using Access = QueryPlan::Access;
+        std::vector<SortEntry> order;
+        presorted = false;
+        const FilterExpr& expr = plan.filter;
+        const FilterExpr::Node& root = expr.node(expr.root());
+        if (root.kind == FilterExpr::Kind::Const && !root.value) {
+            return order;
+        }
+        auto keep = [&](size_t slot) {
+            if (plan.residual.empty()) return true;
+            const TaskView t = tasks[slot];
+            return std::all_of(plan.residual.begin(), plan.residual.end(), [&](int c) { return expr.matches(t, c); });
+        };
+        auto emit = [&order](size_t slot) { order.push_back({0, static_cast<uint32_t>(slot)}); };
+
+        switch (plan.access) {
+            case Access::Scan:
+                if (plan.answered.empty()) {
+                    order.reserve(tasks.size() - tombstones);
+                    for (size_t slot = 0; slot < tasks.size(); slot++) {
+                        if (tasks.is_live(slot)) emit(slot);
+                    }
+                } else {
+                    tasks.scan(expr).for_each(emit);
+                }
+                break;
+            case Access::Bitmaps: {
+                // Only the set bits of the combined bitmap are visited
+                std::vector<RoaringBitmap> bitmaps;
+                for (int c : plan.answered) bitmaps.push_back(bitmap_rows(expr, c));
+                std::sort(bitmaps.begin(), bitmaps.end(), [](const RoaringBitmap& a, const RoaringBitmap& b) {
+                    return a.cardinality() < b.cardinality();
+                });
+                RoaringBitmap rows = std::move(bitmaps[0]);
+                for (size_t i = 1; i < bitmaps.size() && !rows.empty(); i++) {
+                    rows = rows & bitmaps[i];
+                }
+                rows.for_each([&](uint32_t slot) {
+                    if (keep(slot)) emit(slot);
+                });
+                break;
+            }
+            case Access::DueIndex: {
+                const FilterExpr::Node* range = plan.answered.empty() ? nullptr : &expr.node(plan.answered[0]);
+                auto it = range ? due_index.lower_bound({range->lo, INT32_MIN}) : due_index.begin();
+                const auto stop = range && range->hi != INT64_MAX ? due_index.lower_bound({range->hi, INT32_MIN})
+                                                                  : due_index.end();
+                for (; it != stop; ++it) {
+                    const size_t slot = id_index.at(it->second);
+                    if (keep(slot)) emit(slot);
+                }
+                if (!range) {
+                    // Walked for order alone: undated tasks follow in file order
+                    for (size_t slot = 0; slot < tasks.size(); slot++) {
+                        if (tasks.is_live(slot) && tasks.due_date(slot) == kNoDueDate && keep(slot)) emit(slot);
+                    }
+                }
+                if (opts.sort_by == SortBy::DueDate) {
+                    presorted = true;
+                } else if (opts.sort_by == SortBy::Id) {
+                    std::sort(order.begin(), order.end());  // all keys are 0: back to file order
+                }
+                break;
+            }
+            case Access::IdIndex: {
+                const FilterExpr::Node& range = expr.node(plan.answered[0]);
+                for (int64_t id = range.lo; id < std::min<int64_t>(range.hi, next_id); id++) {
+                    const auto slot = find_slot(static_cast<int>(id));
+                    if (slot && keep(*slot)) emit(*slot);
+                }
+                std::sort(order.begin(), order.end());
+                break;
+            }
+        }
+        return order;
+    }
+
+    // Record a mutation: one log append in WAL mode, a full rewrite otherwise
+    void persist(const json& record) {
+        if (storage_mode == StorageMode::Wal) {
+            append_log(record);
+        } else if (defer_saves) {
+            dirty = true;
+        } else {
+            save_tasks();
+        }
+    }
+
+    // Append one compact record per line to the write-ahead log
+    void append_log(const json& record) {
+        if (log_fd < 0) {
+            log_fd = ::open(log_path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+            if (log_fd < 0) {
+                std::cerr << "Error: Could not open log file for writing.\n";
+                return;
+            }
+            if (sync_policy.mode != Durability::None) {
+                sync_parent_dir(log_path);  // make a freshly created log reachable after a crash
+            }
+        }
+        const std::string line = record.dump() + '\n';
+        if (!write_all(log_fd, line.data(), line.size())) {
+            std::cerr << "Error: Could not append to log file: " << std::strerror(errno) << "\n";
+            return;
+        }
+        if (sync_policy.due()) {
+            ::fdatasync(log_fd);
+            sync_policy.synced();
+        }
+        log_bytes += line.size();
+        log_records++;
+        maybe_compact();
+    }
+
+    // Seal the active log and fold it into the snapshot on a background thread.
+    // Writers keep appending to a fresh log meanwhile; load order is
+    // snapshot -> sealed segment -> active log.
+    void maybe_compact() {
+        if (compacting.load()) {
+            return;
+        }
+        if (!sealed_log_pending) {
+            if (log_bytes < compact_log_bytes && log_records < compact_log_records) {
+                return;
+            }
+            sync_pending();
+            close_log();
+            std::error_code ec;
+            fs::rename(log_path, sealed_log_path, ec);
+            if (ec) {
+                std::cerr << "Warning: Could not seal log for compaction: " << ec.message() << "\n";
+                return;
+            }
+            log_bytes = 0;
+            log_records = 0;
+            sealed_log_pending = true;
+        }
+
+        wait_for_compaction();
+        compacting = true;
+        compactor = std::thread([this, fp = file_path, format = snapshot_format, compact = compact_json,
+                                 sync = sync_policy.mode != Durability::None] {
+            // On failure the segment stays pending, so the next call retries
+            // the fold instead of sealing the active log over it
+            if (compact_sealed_log(fp, format, compact, sync)) {
+                sealed_log_pending = false;
+            }
+            compacting = false;
+        });
+    }
+
+    // Rebuild the snapshot from disk and publish it with an atomic rename.
+    // Replaying a sealed segment over a snapshot that already contains it is
+    // idempotent, so a crash between the rename and the unlink is harmless.
+    // Returns false when the snapshot could not be published.
+    static bool compact_sealed_log(const std::string& fp, SnapshotFormat format, bool compact, bool sync) {
+        TaskManager folded(FoldTag{}, fp);
+        folded.compact_slots();
+        folded.snapshot_format = format;
+        folded.compact_json = compact;
+        folded.set_durability(sync ? Durability::Sync : Durability::None);
+        if (!folded.publish_snapshot(fp + ".compact")) {
+            std::cerr << "Error: Could not publish compacted snapshot.\n";
+            return false;
+        }
+        std::error_code ec;
+        fs::remove(folded.sealed_log_path, ec);
+        return true;
+    }
+
+    // Apply a single log record to the in-memory state
+    void apply_record(const json& record) {
+        const auto op = record.at("op").get<std::string>();
+        if (op == "add") {
+            const Task task = record.at("task").get<Task>();
+            if (auto existing = find_slot(task.id)) {
+                // Only reachable when a segment is replayed over a snapshot that already folded it
+                unindex_due(*existing);
+                tasks.assign(*existing, view_of(task));
+                index_due(*existing);
+                return;
+            }
+            next_id = std::max(next_id, task.id + 1);
+            id_index[task.id] = tasks.size();
+            tasks.push_back(task);
+            index_due(tasks.size() - 1);
+            search_index.add(task.id, task.description);
+            if (substring_index_built) {
+                substring_index.add(task.id, task.description);
+            }
+        } else if (op == "complete" || op == "delete") {
+            const int id = record.at("id").get<int>();
+            auto slot = find_slot(id);
+            if (!slot) {
+                return;
+            }
+            if (op == "complete") {
+                tasks.set_completed(*slot);
+            } else {
+                retire_task(id);
+            }
+        } else if (op == "clear") {
+            tasks.clear();
+            id_index.clear();
+            due_index.clear();
+            search_index.clear();
+            substring_index.clear();
+            tombstones = 0;
+            next_id = 1;
+        }
+    }
+
+    // Replay a write-ahead log on top of the loaded state; returns the records applied
+    size_t replay_log(const std::string& path) {
+        std::ifstream log(path);
+        if (!log.is_open()) {
+            return 0;
+        }
+
+        std::string line;
+        size_t line_no = 0;
+        size_t applied = 0;
+        while (std::getline(log, line)) {
+            line_no++;
+            if (line.empty()) {
+                continue;
+            }
+            try {
+                apply_record(json::parse(line));
+                applied++;
+            } catch (const json::exception& e) {
+                // A torn final record from an interrupted append is expected; stop there
+                std::cerr << "Warning: Ignoring log from line " << line_no << ": " << e.what() << "\n";
+                break;
+            }
+        }
+        return applied;
+    }
+
+    // Load tasks from JSON snapshot, then replay the sealed and active logs
+    void load_tasks() {
+        load_snapshot();
+        sealed_log_pending = fs::exists(sealed_log_path);
+        if (sealed_log_pending) {
+            replay_log(sealed_log_path);
+        }
+        log_records = replay_log(log_path);
+        std::error_code ec;
+        log_bytes = log_records ? fs::file_size(log_path, ec) : 0;
+        if (ec) {
+            log_bytes = 0;
+        }
+        compact_slots();
+    }
+
+    // Load the base snapshot only, in whichever format it was written
+    void load_snapshot() {
+        if (MappedTaskFile::is_binary(file_path)) {
+            snapshot_format = SnapshotFormat::Binary;
+            load_binary_snapshot();
+            return;
+        }
+
+        std::ifstream file(file_path, std::ios::binary);
+        if (file.is_open()) {
+            std::error_code ec;
+            const auto size = fs::file_size(file_path, ec);
+            std::string buffer(ec ? 0 : static_cast<size_t>(size), '\0');
+            file.read(&buffer[0], static_cast<std::streamsize>(buffer.size()));
+            buffer.resize(static_cast<size_t>(file.gcount()));  // the file may have shrunk since
+
+            tasks.reset(buffer.size());  // the JSON text outweighs the columns it decodes to
+            TaskSaxHandler handler(tasks);
+            if (ec) {
+                std::cerr << "Error parsing tasks file: " << ec.message() << "\n";
+                tasks.clear();
+            } else if (!json::sax_parse(buffer, &handler)) {
+                std::cerr << "Error parsing tasks file: " << handler.error << "\n";
+                tasks.clear();
+            } else if (!tasks.empty()) {
+                next_id = tasks.max_id() + 1;
+            }
+        }
+        rebuild_index();
+        rebuild_due_index();
+        load_search_index();
+    }
+
+    // Materialize tasks from a mapped binary snapshot
+    void load_binary_snapshot() {
+        MappedTaskFile mapped(file_path);
+        if (!mapped.is_open()) {
+            std::cerr << "Error parsing tasks file: unreadable binary snapshot\n";
+            return;
+        }
+        tasks.reset(TaskStore::arena_bytes_for(mapped.size(), mapped.heap_size()));
+        tasks.reserve(mapped.size(), mapped.heap_size());
+        for (size_t i = 0; i < mapped.size(); i++) {
+            const TaskView view = mapped[i];
+            tasks.push_back(view);
+            next_id = std::max(next_id, view.id + 1);
+        }
+        rebuild_index();
+        rebuild_due_index();
+        load_search_index();
+    }
+
+    void close_log() {
+        if (log_fd >= 0) {
+            ::close(log_fd);
+            log_fd = -1;
+        }
+    }
+
+    // Serialize the live tasks to path in the configured snapshot format
+    bool write_snapshot(const std::string& path, bool sync) {
+        write_buffer.clear();
+        if (snapshot_format == SnapshotFormat::Binary) {
+            encode_binary_snapshot(tasks, write_buffer);
+        } else {
+            TaskJsonWriter(write_buffer, compact_json).write(tasks);
+        }
+        if (!write_whole_file(path, write_buffer, sync)) {
+            std::cerr << "Error: Could not write " << path << ": " << std::strerror(errno) << "\n";
+            return false;
+        }
+        return true;
+    }
+
+    // Write the snapshot to tmp_path, keep the current file as .bak through a
+    // hard link, then rename the new file into place. Readers and crashes see
+    // either the old or the new snapshot, never a torn one.
+    bool publish_snapshot(const std::string& tmp_path) {
+        std::error_code ec;
+        const bool sync = sync_policy.due();
+        if (!write_snapshot(tmp_path, sync)) {
+            fs::remove(tmp_path, ec);
+            return false;
+        }
+
+        const std::string bak_path = file_path + ".bak";
+        ::unlink(bak_path.c_str());
+        if (::link(file_path.c_str(), bak_path.c_str()) != 0 && errno != ENOENT) {
+            // Filesystems without hard links still get a backup, just a copied one
+            fs::copy_file(file_path, bak_path, fs::copy_options::overwrite_existing, ec);
+        }
+
+        if (::rename(tmp_path.c_str(), file_path.c_str()) != 0) {
+            std::cerr << "Error: Could not replace " << file_path << ": " << std::strerror(errno) << "\n";
+            fs::remove(tmp_path, ec);
+            return false;
+        }
+        if (sync) {
+            sync_parent_dir(file_path);
+            sync_policy.synced();
+        }
+        save_search_index();
+        return true;
+    }
+
+    // Save tasks with backup; the snapshot supersedes any write-ahead log
+    void save_tasks() {
+        compact_slots();
+        if (!publish_snapshot(file_path + ".tmp")) {
+            std::cerr << "Error: Could not write tasks file.\n";
+            return;
+        }
+        dirty = false;
+
+        close_log();
+        std::error_code ec;
+        fs::remove(log_path, ec);
+        fs::remove(sealed_log_path, ec);
+        log_bytes = 0;
+        log_records = 0;
+        sealed_log_pending = false;
+    }
+};
+
+// CLI parsing
+cxxopts::Options setup_options() {
+    cxxopts::Options options("TaskManager", "A CLI tool to manage tasks with priorities and categories.");
+    options.add_options()
+        ("c,command", "Command (add|list|search|complete|delete|clear)", cxxopts::value<std::string>())
+        ("d,description", "Task description", cxxopts::value<std::string>()->default_value(""))
+        ("due-date", "Due date (YYYY-MM-DD)", cxxopts::value<std::string>()->default_value(""))
+        ("p,priority", "Priority (low|medium|high); with list, only show this priority", cxxopts::value<std::string>()->default_value("medium"))
+        ("category", "Task category (with list: only show this category)", cxxopts::value<std::string>()->default_value("General"))
+        ("s,sort-by", "Sort list by (id|priority|due_date)", cxxopts::value<std::string>()->default_value("id"))
+        ("i,id", "Task ID", cxxopts::value<int>()->default_value("0"))
+        ("q,query", "Words a description must contain, for search", cxxopts::value<std::string>()->default_value(""))
+        ("substring", "With search, match the query as an exact substring of the description")
+        ("limit", "Show at most N tasks (0 = all)", cxxopts::value<int>()->default_value("0"))
+        ("offset", "Skip the first N tasks of the listing", cxxopts::value<int>()->default_value("0"))
+        ("due-before", "List tasks due before a date (YYYY-MM-DD)", cxxopts::value<std::string>())
+        ("due-after", "List tasks due after a date (YYYY-MM-DD)", cxxopts::value<std::string>())
+        ("overdue", "List pending tasks whose due date has passed")
+        ("status", "List only pending or done tasks (pending|done)", cxxopts::value<std::string>())
+        ("w,where", "List tasks matching an expression, e.g. 'priority>=medium && !completed && due<2026-11-01'",
+            cxxopts::value<std::string>())
+        ("explain", "With list, print the query plan with estimated and actual row counts")
+        ("wal", "Append mutations to a write-ahead log instead of rewriting the tasks file")
+        ("checkpoint", "Fold the write-ahead log into the tasks file before exiting")
+        ("format", "Snapshot format for writes (json|binary)", cxxopts::value<std::string>())
+        ("compact", "Write JSON snapshots without indentation")
+        ("serve", "Keep the tasks resident and serve commands on tasks.json.sock")
+        ("batch", "Run newline-delimited commands from --batch=FILE (stdin when omitted)",
+            cxxopts::value<std::string>()->implicit_value("-"))
+        ("durability", "Sync policy for saves (none|batch|fsync)", cxxopts::value<std::string>())
+        ("group-commit-ops", "With --durability batch, sync at least every N mutations",
+            cxxopts::value<int>()->default_value("64"))
+        ("group-commit-ms", "With --durability batch, sync at least every N milliseconds",
+            cxxopts::value<int>()->default_value("50"))
+        ("save-every", "In batch mode, write the tasks file every N commands (0 = only at the end)",
+            cxxopts::value<int>()->default_value("0"))
+        ("h,help", "Print usage");
+    return options;
+}
+
+// Parse priority from string
+Priority parse_priority(const std::string& p) {
+    if (p == "low") return Priority::Low;
+    if (p == "high") return Priority::High;
+    return Priority::Medium;
+}
+
+// Default tasks file, and the socket a --serve daemon listens on
+const std::string kTasksFile = "tasks.json";
+const std::string kSocketPath = kTasksFile + ".sock";
+
+// Read --sort-by/--limit/--offset into ListOptions
+bool parse_list_options(const cxxopts::ParseResult& result, ListOptions& opts) {
+    const auto limit = result["limit"].as<int>();
+    const auto offset = result["offset"].as<int>();
+    if (limit < 0 || offset < 0) {
+        std::cerr << "Error: --limit and --offset must not be negative.\n";
+        return false;
+    }
+    opts.sort_by = parse_sort_by(result["sort-by"].as<std::string>());
+    opts.offset = static_cast<size_t>(offset);
+    opts.limit = limit > 0 ? static_cast<size_t>(limit) : SIZE_MAX;
+    if (result.count("category")) {
+        opts.category = result["category"].as<std::string>();
+    }
+    if (result.count("priority")) {
+        opts.priority = parse_priority(result["priority"].as<std::string>());
+    }
+    if (result.count("status")) {
+        const auto status = result["status"].as<std::string>();
+        if (status != "pending" && status != "done") {
+            std::cerr << "Error: --status expects pending or done.\n";
+            return false;
+        }
+        opts.completed = status == "done";
+    }
+    opts.explain = result.count("explain") > 0;
+    if (result.count("where")) {
+        std::string error;
+        opts.where = FilterExpr::parse(result["where"].as<std::string>(), error);
+        if (!opts.where) {
+            std::cerr << "Error: --where: " << error << ".\n";
+            return false;
+        }
+    }
+    auto parse_day = [&result](const char* name, int64_t& day) {
+        if (parse_fixed_timestamp(result[name].as<std::string>(), false, day)) {
+            return true;
+        }
+        std::cerr << "Error: --" << name << " expects a date as YYYY-MM-DD.\n";
+        return false;
+    };
+    int64_t day;
+    if (result.count("due-before")) {
+        if (!parse_day("due-before", day)) return false;
+        opts.due_until = day;
+    }
+    if (result.count("due-after")) {
+        if (!parse_day("due-after", day)) return false;
+        opts.due_from = day + 86400;  // after the whole day, not just its midnight
+    }
+    if (result.count("overdue")) {
+        const int64_t now = to_epoch_seconds(system_clock::now());
+        const int64_t today = now - ((now % 86400) + 86400) % 86400;
+        opts.due_until = std::min(opts.due_until.value_or(today), today);
+        opts.completed = false;
+    }
+    return true;
+}
+
+// Apply --format/--compact to a manager
+bool apply_storage_options(TaskManager& manager, const cxxopts::ParseResult& result) {
+    if (result.count("format")) {
+        const auto format = result["format"].as<std::string>();
+        if (format != "json" && format != "binary") {
+            std::cerr << "Error: Unknown format '" << format << "'.\n";
+            return false;
+        }
+        manager.set_snapshot_format(format == "binary" ? SnapshotFormat::Binary : SnapshotFormat::Json);
+    }
+    if (result.count("compact")) {
+        manager.set_compact_json(true);
+    }
+    return true;
+}
+
+// Apply --durability and its group-commit knobs. Kept apart from the per-command
+// storage options so a forwarded command cannot change a daemon's policy.
+bool apply_durability_options(TaskManager& manager, const cxxopts::ParseResult& result) {
+    if (!result.count("durability")) {
+        return true;
+    }
+    const auto mode = result["durability"].as<std::string>();
+    const auto ops = result["group-commit-ops"].as<int>();
+    const auto ms = result["group-commit-ms"].as<int>();
+    if ((mode != "none" && mode != "batch" && mode != "fsync") || ops <= 0 || ms < 0) {
+        std::cerr << "Error: Invalid durability settings.\n";
+        return false;
+    }
+    manager.set_durability(parse_durability(mode), static_cast<size_t>(ops), milliseconds(ms));
+    return true;
+}
+
+// Print how many syncs the chosen durability level actually cost
+void report_durability(TaskManager& manager) {
+    manager.sync_pending();
+    std::cerr << "Durability " << durability_to_string(manager.durability()) << ": "
+              << manager.sync_count() << " sync(s) performed\n";
+}
+
+// Run one parsed command against a manager; returns the exit code
+int run_command(TaskManager& manager, const cxxopts::ParseResult& result, const cxxopts::Options& options) {
+    if (!apply_storage_options(manager, result)) {
+        return 1;
+    }
+
+    const auto command = result["command"].as<std::string>();
+    if (command == "add") {
+        const auto desc = result["description"].as<std::string>();
+        if (desc.empty()) {
+            std::cerr << "Error: Description required for add command.\n";
+            return 1;
+        }
+        const auto due = result["due-date"].as<std::string>();
+        const auto pri = parse_priority(result["priority"].as<std::string>());
+        const auto cat = result["category"].as<std::string>();
+        manager.add_task(desc, due.empty() ? std::nullopt : std::make_optional(due), pri, cat);
+    } else if (command == "list") {
+        ListOptions list_opts;
+        if (!parse_list_options(result, list_opts)) {
+            return 1;
+        }
+        manager.list_tasks(list_opts);
+    } else if (command == "search") {
+        const auto query = result["query"].as<std::string>();
+        if (query.empty()) {
+            std::cerr << "Error: Query required for search command.\n";
+            return 1;
+        }
+        ListOptions list_opts;
+        if (!parse_list_options(result, list_opts)) {
+            return 1;
+        }
+        manager.search_tasks(query, list_opts, result.count("substring") > 0);
+    } else if (command == "complete") {
+        const auto id = result["id"].as<int>();
+        if (id <= 0) {
+            std::cerr << "Error: Valid ID required for complete command.\n";
+            return 1;
+        }
+        manager.complete_task(id);
+    } else if (command == "delete") {
+        const auto id = result["id"].as<int>();
+        if (id <= 0) {
+            std::cerr << "Error: Valid ID required for delete command.\n";
+            return 1;
+        }
+        manager.delete_task(id);
+    } else if (command == "clear") {
+        manager.clear_tasks();
+    } else {
+        std::cerr << "Unknown command: " << command << "\n";
+        std::cout << options.help() << std::endl;
+        return 1;
+    }
+
+    if (result.count("checkpoint")) {
+        manager.checkpoint();
+    }
+    return 0;
+}
+
+// Daemon wire format (host-endian, local socket only):
+//   request: u32 argc, then argc x (u32 length, bytes)
+//   reply:   i32 exit code, stdout (u32 length, bytes), stderr (u32 length, bytes)
+constexpr uint32_t kMaxDaemonArgs = 256;
+constexpr uint32_t kMaxDaemonString = 64 * 1024 * 1024;
+// A client that stalls mid-request or stops reading its reply is dropped
+// after kDaemonIoTimeout, so it cannot hold up every command queued behind
+// it. The CLI waits up to kDaemonReplyTimeout for each read of the reply.
+constexpr milliseconds kDaemonIoTimeout(5000);
+constexpr milliseconds kDaemonReplyTimeout(60000);
+// Exit code when a request reached the daemon but no reply came back: the
+// command may or may not have been applied, so retrying is not safe
+constexpr int kExitOutcomeUnknown = 3;
+// First argument of a forwarded batch chunk: {kDaemonBatchRequest, first line
+// number, newline-delimited commands}. Not a valid option, so it cannot clash
+// with a forwarded command line.
+const std::string kDaemonBatchRequest = "\x01" "batch";
+constexpr size_t kBatchChunkBytes = 16 * 1024 * 1024;
+
+void put_string(std::string& out, const std::string& s) {
+    const uint32_t len = static_cast<uint32_t>(s.size());
+    out.append(reinterpret_cast<const char*>(&len), sizeof(len));
+    out += s;
+}
+
+bool read_string(int fd, std::string& s) {
+    uint32_t len;
+    if (!read_all(fd, &len, sizeof(len)) || len > kMaxDaemonString) {
+        return false;
+    }
+    s.resize(len);
+    return len == 0 || read_all(fd, &s[0], len);
+}
+
+// Bound every blocking read and write on a socket by timeout
+bool set_socket_timeout(int fd, milliseconds timeout) {
+    timeval tv{};
+    tv.tv_sec = static_cast<time_t>(timeout.count() / 1000);
+    tv.tv_usec = static_cast<suseconds_t>((timeout.count() % 1000) * 1000);
+    return ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) == 0 &&
+           ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv)) == 0;
+}
+
+sockaddr_un socket_address(const std::string& path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    return addr;
+}
+
+// Connect to a running daemon; -1 when none is listening
+int connect_daemon(const std::string& path) {
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    const sockaddr_un addr = socket_address(path);
+    if (::connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Hand the command line to a running daemon and relay its output.
+// Returns nullopt when no daemon answers, so the caller can go direct, and
+// kExitOutcomeUnknown when the request went out but no reply came back.
+// The timeout bounds each read of the reply separately, so it restarts
+// whenever the reply makes progress; zero waits as long as the daemon takes.
+std::optional<int> forward_to_daemon(const std::string& path, const std::vector<std::string>& args,
+                                     milliseconds reply_timeout = kDaemonReplyTimeout) {
+    if (!fs::exists(path)) {
+        return std::nullopt;
+    }
+    int fd = connect_daemon(path);
+    if (fd < 0) {
+        return std::nullopt;
+    }
+    if (reply_timeout.count() > 0) {
+        set_socket_timeout(fd, reply_timeout);
+    }
+
+    std::string request;
+    const uint32_t count = static_cast<uint32_t>(args.size());
+    request.append(reinterpret_cast<const char*>(&count), sizeof(count));
+    for (const auto& arg : args) {
+        put_string(request, arg);
+    }
+
+    int32_t code;
+    std::string out, err;
+    const bool sent = write_all(fd, request.data(), request.size());
+    errno = 0;
+    const bool ok = sent && read_all(fd, &code, sizeof(code)) && read_string(fd, out) && read_string(fd, err);
+    const bool timed_out = !ok && (errno == EAGAIN || errno == EWOULDBLOCK);
+    ::close(fd);
+    if (!sent) {
+        std::cerr << "Error: Could not send the command to the task daemon.\n";
+        return 1;
+    }
+    if (!ok) {
+        std::cerr << (timed_out ? "Error: Task daemon did not answer within " +
+                                      std::to_string(reply_timeout.count() / 1000) + "s"
+                                : std::string("Error: Lost connection to task daemon"))
+                  << "; the command may still be applied, so check before retrying.\n";
+        return kExitOutcomeUnknown;
+    }
+    std::cout << out;
+    std::cerr << err;
+    return code;
+}
+
+// Split a batch line into arguments, honouring quotes and backslash escapes
+bool split_command_line(const std::string& line, std::vector<std::string>& args) {
+    std::string current;
+    bool in_arg = false;
+    char quote = 0;
+    for (size_t i = 0; i < line.size(); i++) {
+        const char c = line[i];
+        if (c == '\\' && quote != '\'' && i + 1 < line.size()) {
+            current += line[++i];
+            in_arg = true;
+        } else if (quote) {
+            if (c == quote) quote = 0;
+            else current += c;
+        } else if (c == '"' || c == '\'') {
+            quote = c;
+            in_arg = true;
+        } else if (std::isspace(static_cast<unsigned char>(c))) {
+            if (in_arg) args.push_back(std::move(current));
+            current.clear();
+            in_arg = false;
+        } else {
+            current += c;
+            in_arg = true;
+        }
+    }
+    if (in_arg) args.push_back(std::move(current));
+    return quote == 0;
+}
+
+// Run newline-delimited command lines against manager with snapshot writes
+// deferred: one every save_every commands (0 = never midway) and one when the
+// input ends, rather than one per mutation. Messages number lines from
+// first_line. Returns how many lines failed.
+size_t run_batch_lines(std::istream& in, TaskManager& manager, size_t first_line, size_t save_every) {
+    manager.set_deferred_saves(true);
+    auto options = setup_options();
+    std::string line;
+    size_t line_no = first_line - 1;
+    size_t since_save = 0;
+    size_t failures = 0;
+    while (std::getline(in, line)) {
+        line_no++;
+        std::vector<std::string> args;
+        if (!split_command_line(line, args)) {
+            std::cerr << "Line " << line_no << ": unbalanced quote\n";
+            failures++;
+            continue;
+        }
+        if (args.empty() || args[0][0] == '#') {
+            continue;
+        }
+
+        int code = 1;
+        args.insert(args.begin(), "TaskManager");
+        std::vector<const char*> argv;
+        for (const auto& arg : args) {
+            argv.push_back(arg.c_str());
+        }
+        try {
+            int argc = static_cast<int>(argv.size());
+            const char** argv_ptr = argv.data();
+            auto result = options.parse(argc, argv_ptr);
+            if (!result.count("command")) {
+                std::cerr << "Line " << line_no << ": missing --command\n";
+            } else {
+                code = run_command(manager, result, options);
+            }
+        } catch (const cxxopts::OptionException& e) {
+            std::cerr << "Line " << line_no << ": " << e.what() << "\n";
+        }
+        if (save_every && ++since_save >= save_every) {
+            manager.flush();
+            since_save = 0;
+        }
+        if (code != 0) {
+            failures++;
+        }
+    }
+    manager.flush();
+    manager.set_deferred_saves(false);
+    return failures;
+}
+
+// Run a batch directly against the tasks file. unsent holds lines already
+// taken from in, numbered from first_line, which run before the rest of in.
+int run_batch_locally(std::istream& in, const cxxopts::ParseResult& outer, const std::string& unsent,
+                      size_t first_line, size_t save_every) {
+    TaskManager manager(kTasksFile, outer.count("wal") ? StorageMode::Wal : StorageMode::Snapshot, LockMode::Exclusive);
+    if (!apply_storage_options(manager, outer) || !apply_durability_options(manager, outer)) {
+        return 1;
+    }
+    std::istringstream head(unsent);
+    size_t failures = run_batch_lines(head, manager, first_line, save_every);
+    failures += run_batch_lines(in, manager, first_line + std::count(unsent.begin(), unsent.end(), '\n'), save_every);
+    if (outer.count("durability")) {
+        report_durability(manager);
+    }
+    return failures ? 1 : 0;
+}
+
+// Send a batch to a running daemon in chunks of save_every commands (or of
+// kBatchChunkBytes when save_every is 0). The daemon runs each chunk through
+// run_batch_lines, so it writes one snapshot per chunk, not per command.
+// A chunk may take the daemon arbitrarily long, so there is no reply
+// timeout; if the connection drops mid-chunk the rest of the batch is not
+// sent, since nobody can tell which of its lines were applied. If the
+// daemon is gone before a chunk is sent, that chunk and the rest of the
+// input run directly against the tasks file instead.
+int forward_batch(std::istream& in, const cxxopts::ParseResult& outer, size_t save_every) {
+    std::string chunk;
+    std::string line;
+    size_t line_no = 0;
+    size_t first_line = 1;
+    size_t commands = 0;
+    bool failed = false;
+    bool unknown = false;
+    // Returns false when the daemon could not be reached, leaving chunk unsent
+    auto send = [&] {
+        if (!chunk.empty() && !unknown) {
+            const std::vector<std::string> request{kDaemonBatchRequest, std::to_string(first_line), chunk};
+            const auto reply = forward_to_daemon(kSocketPath, request, milliseconds(0));
+            if (!reply) {
+                return false;
+            }
+            const int code = *reply;
+            if (code == kExitOutcomeUnknown) {
+                std::cerr << "Error: Lines " << first_line << "-" << line_no
+                          << " may be partly applied; stopped before the rest of the batch.\n";
+                unknown = true;
+            }
+            failed |= code != 0;
+        }
+        chunk.clear();
+        commands = 0;
+        first_line = line_no + 1;
+        return true;
+    };
+    auto run_rest_locally = [&] {
+        std::cerr << "Task daemon went away at line " << first_line << "; running the rest of the batch directly.\n";
+        return std::max(run_batch_locally(in, outer, chunk, first_line, save_every), failed ? 1 : 0);
+    };
+    while (std::getline(in, line)) {
+        line_no++;
+        chunk += line;
+        chunk += '\n';
+        std::vector<std::string> args;
+        if (split_command_line(line, args) && !args.empty() && args[0][0] != '#') {
+            commands++;
+        }
+        if (((save_every && commands >= save_every) || chunk.size() >= kBatchChunkBytes) && !send()) {
+            return run_rest_locally();
+        }
+    }
+    if (!send()) {
+        return run_rest_locally();
+    }
+    return unknown ? kExitOutcomeUnknown : failed ? 1 : 0;
+}
+
+volatile std::sig_atomic_t daemon_stop_requested = 0;
+
+void request_daemon_stop(int) {
+    daemon_stop_requested = 1;
+}
+
+// Run one forwarded command, capturing everything it prints. --format and
+// --compact apply to that request only; the next client gets the daemon's own.
+void handle_daemon_client(int fd, TaskManager& manager) {
+    uint32_t count;
+    if (!read_all(fd, &count, sizeof(count)) || count > kMaxDaemonArgs) {
+        return;
+    }
+    std::vector<std::string> args(count + 1);
+    args[0] = "TaskManager";
+    for (uint32_t i = 1; i <= count; i++) {
+        if (!read_string(fd, args[i])) {
+            return;
+        }
+    }
+    std::vector<const char*> argv;
+    for (const auto& arg : args) {
+        argv.push_back(arg.c_str());
+    }
+
+    std::ostringstream out, err;
+    std::streambuf* saved_out = std::cout.rdbuf(out.rdbuf());
+    std::streambuf* saved_err = std::cerr.rdbuf(err.rdbuf());
+    int32_t code = 0;
+    auto options = setup_options();
+    const SnapshotFormat saved_format = manager.format();
+    const bool saved_compact = manager.compacts_json();
+    try {
+        if (count == 3 && args[1] == kDaemonBatchRequest) {
+            std::istringstream lines(args[3]);
+            code = run_batch_lines(lines, manager, std::stoull(args[2]), 0) ? 1 : 0;
+        } else {
+            int argc = static_cast<int>(argv.size());
+            const char** argv_ptr = argv.data();
+            auto result = options.parse(argc, argv_ptr);
+            code = run_command(manager, result, options);
+        }
+    } catch (const cxxopts::OptionException& e) {
+        std::cerr << "Error parsing options: " << e.what() << "\n";
+        code = 1;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        code = 1;
+    }
+    manager.set_snapshot_format(saved_format);
+    manager.set_compact_json(saved_compact);
+    std::cout.flush();
+    std::cout.rdbuf(saved_out);
+    std::cerr.rdbuf(saved_err);
+
+    std::string reply(reinterpret_cast<const char*>(&code), sizeof(code));
+    put_string(reply, out.str());
+    put_string(reply, err.str());
+    write_all(fd, reply.data(), reply.size());
+}
+
+// Keep one TaskManager resident and serve commands over a Unix socket until SIGINT/SIGTERM
+int serve(const std::string& socket_path, TaskManager& manager) {
+    int probe = connect_daemon(socket_path);
+    if (probe >= 0) {
+        ::close(probe);
+        std::cerr << "Error: A task daemon is already listening on " << socket_path << ".\n";
+        return 1;
+    }
+    ::unlink(socket_path.c_str());  // stale socket from a daemon that died
+
+    int listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    const sockaddr_un addr = socket_address(socket_path);
+    if (listener < 0 || ::bind(listener, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        ::listen(listener, 64) != 0) {
+        std::cerr << "Error: Could not listen on " << socket_path << ": " << std::strerror(errno) << "\n";
+        if (listener >= 0) ::close(listener);
+        return 1;
+    }
+
+    struct sigaction sa{};
+    sa.sa_handler = request_daemon_stop;  // no SA_RESTART, so accept() returns EINTR
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    std::cout << "Serving tasks on " << socket_path << "\n" << std::flush;
+    while (!daemon_stop_requested) {
+        if (manager.has_unsynced()) {
+            // Group commit: sync once the interval passes without another command
+            pollfd pfd{listener, POLLIN, 0};
+            const int ready = ::poll(&pfd, 1, static_cast<int>(manager.group_commit_interval().count()));
+            if (ready == 0) {
+                manager.sync_pending();
+                continue;
+            }
+            if (ready < 0) {
+                continue;  // EINTR: re-check the stop flag
+            }
+        }
+        int client = ::accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            std::cerr << "Error: accept failed: " << std::strerror(errno) << "\n";
+            break;
+        }
+        set_socket_timeout(client, kDaemonIoTimeout);
+        handle_daemon_client(client, manager);
+        ::close(client);
+    }
+
+    ::close(listener);
+    ::unlink(socket_path.c_str());
+    if (manager.durability() != Durability::None) {
+        report_durability(manager);
+    }
+    return 0;
+}
+
+// Run a batch against one TaskManager, or hand it to a running daemon
+int run_batch(std::istream& in, const cxxopts::ParseResult& outer, size_t save_every) {
+    const int probe = connect_daemon(kSocketPath);
+    if (probe >= 0) {
+        ::close(probe);
+        return forward_batch(in, outer, save_every);
+    }
+    return run_batch_locally(in, outer, "", 1, save_every);
+}
+
+// Main function
+int main(int argc, char* argv[]) {
+    auto options = setup_options();
+    try {
+        auto result = options.parse(argc, argv);
+        const StorageMode mode = result.count("wal") ? StorageMode::Wal : StorageMode::Snapshot;
+
+        if (result.count("serve")) {
+            TaskManager manager(kTasksFile, mode, LockMode::Exclusive);
+            if (!apply_storage_options(manager, result) || !apply_durability_options(manager, result)) {
+                return 1;
+            }
+            return serve(kSocketPath, manager);
+        }
+
+        if (result.count("batch") && !result.count("help")) {
+            const auto source = result["batch"].as<std::string>();
+            const auto save_every = result["save-every"].as<int>();
+            if (save_every < 0) {
+                std::cerr << "Error: --save-every must not be negative.\n";
+                return 1;
+            }
+            if (source == "-") {
+                return run_batch(std::cin, result, static_cast<size_t>(save_every));
+            }
+            std::ifstream file(source);
+            if (!file.is_open()) {
+                std::cerr << "Error: Could not open batch file " << source << ".\n";
+                return 1;
+            }
+            return run_batch(file, result, static_cast<size_t>(save_every));
+        }
+
+        if (result.count("help") || !result.count("command")) {
+            std::cout << options.help() << std::endl;
+            return 0;
+        }
+
+        if (auto code = forward_to_daemon(kSocketPath, std::vector<std::string>(argv + 1, argv + argc))) {
+            return *code;
+        }
+
+        const auto command = result["command"].as<std::string>();
+        const bool read_only = (command == "list" || command == "search") && !result.count("checkpoint");
+        if (read_only && command == "list") {
+            ListOptions list_opts;
+            if (!parse_list_options(result, list_opts)) {
+                return 1;
+            }
+            if (!list_opts.explain && TaskManager::list_mapped(kTasksFile, list_opts)) {
+                return 0;
+            }
+        }
+
+        TaskManager manager(kTasksFile, mode, read_only ? LockMode::Shared : LockMode::Exclusive);
+        if (!apply_durability_options(manager, result)) {
+            return 1;
+        }
+        const int code = run_command(manager, result, options);
+        if (result.count("durability")) {
+            report_durability(manager);
+        }
+        return code;
+    } catch (const cxxopts::OptionException& e) {
+        std::cerr << "Error parsing options: " << e.what() << "\n";
+        std::cout << options.help() << std::endl;
+        return 1;
+    }
+}
+
+// Tests
+void run_tests() {
+    TaskManager tm("test_tasks.json");
+    std::cout << "Running tests...\n";
+
+    // Test 1: Add task
+    tm.add_task("Test task", std::nullopt, Priority::Medium, "General");
+    if (tm.tasks.size() != 1 || tm.tasks[0].description != "Test task") {
+        std::cerr << "Test 1 failed: Add task\n";
+        return;
+    }
+
+    // Test 2: Complete task
+    tm.complete_task(1);
+    if (!tm.tasks[0].completed) {
+        std::cerr << "Test 2 failed: Complete task\n";
+        return;
+    }
+
+    // Test 3: Add task with priority and category
+    tm.add_task("High priority task", std::nullopt, Priority::High, "Work");
+    if (tm.tasks.size() != 2 || tm.tasks[1].priority != Priority::High || tm.tasks[1].category != "Work") {
+        std::cerr << "Test 3 failed: Add task with priority and category\n";
+        return;
+    }
+
+    // Test 4: Delete task
+    tm.delete_task(1);
+    if (tm.tasks.size() != 1 || tm.tasks[0].id != 2) {
+        std::cerr << "Test 4 failed: Delete task\n";
+        return;
+    }
+
+    // Test 5: Clear tasks
+    tm.clear_tasks();
+    if (!tm.tasks.empty() || tm.next_id != 1) {
+        std::cerr << "Test 5 failed: Clear tasks\n";
+        return;
+    }
+
+    // Test 6: Persistence
+    tm.add_task("Persistent task", std::nullopt, Priority::Low, "Personal");
+    TaskManager tm2("test_tasks.json");
+    if (tm2.tasks.size() != 1 || tm2.tasks[0].description != "Persistent task") {
+        std::cerr << "Test 6 failed: Persistence\n";
+        return;
+    }
+
+    // Test 7: Write-ahead log replay
+    {
+        TaskManager wal("test_wal_tasks.json", StorageMode::Wal);
+        wal.clear_tasks();
+        wal.add_task("Logged task", std::nullopt, Priority::High, "Work");
+        wal.add_task("Discarded task", std::nullopt, Priority::Low, "Work");
+        wal.complete_task(1);
+        wal.delete_task(2);
+    }
+    TaskManager wal2("test_wal_tasks.json", StorageMode::Wal);
+    if (wal2.tasks.size() != 1 || !wal2.tasks[0].completed || wal2.next_id != 3) {
+        std::cerr << "Test 7 failed: Write-ahead log replay\n";
+        return;
+    }
+
+    // Test 8: Background log compaction
+    {
+        TaskManager wal("test_wal_tasks.json", StorageMode::Wal);
+        wal.set_compaction_threshold(1 << 20, 3);
+        wal.clear_tasks();
+        for (int i = 0; i < 5; i++) {
+            wal.add_task("Compacted task", std::nullopt, Priority::Medium, "General");
+        }
+        wal.wait_for_compaction();
+    }
+    TaskManager wal3("test_wal_tasks.json", StorageMode::Wal);
+    if (!fs::exists("test_wal_tasks.json") || wal3.tasks.size() != 5 || wal3.next_id != 6) {
+        std::cerr << "Test 8 failed: Background log compaction\n";
+        return;
+    }
+    {
+        // A fold that cannot publish keeps its segment pending and is retried
+        for (const char* suffix : {"", ".log", ".log.1"}) {
+            fs::remove(std::string("test_fold_tasks.json") + suffix);
+        }
+        TaskManager wal("test_fold_tasks.json", StorageMode::Wal);
+        wal.set_compaction_threshold(1 << 20, 3);
+        wal.clear_tasks();
+        fs::create_directory("test_fold_tasks.json.compact");
+        for (int i = 0; i < 3; i++) {
+            wal.add_task("Sealed task", std::nullopt, Priority::Medium, "General");
+        }
+        wal.wait_for_compaction();
+        fs::remove("test_fold_tasks.json.compact");
+        for (int i = 0; i < 3; i++) {
+            wal.add_task("Later task", std::nullopt, Priority::Medium, "General");
+        }
+        wal.wait_for_compaction();
+    }
+    TaskManager wal4("test_fold_tasks.json", StorageMode::Wal);
+    const auto sealed = std::count_if(wal4.tasks.begin(), wal4.tasks.end(),
+                                      [](const TaskView& t) { return t.description == "Sealed task"; });
+    if (wal4.tasks.size() != 6 || sealed != 3 || wal4.next_id != 7) {
+        std::cerr << "Test 8 failed: Retried log compaction\n";
+        return;
+    }
+
+    // Test 9: Id index with deferred tombstone compaction
+    {
+        TaskManager idx("test_wal_tasks.json", StorageMode::Wal);
+        idx.clear_tasks();
+        for (int i = 0; i < 4; i++) {
+            idx.add_task("Indexed task", std::nullopt, Priority::Medium, "General");
+        }
+        idx.delete_task(2);
+        idx.complete_task(4);
+        if (idx.tasks.size() != 4 || idx.tombstones != 1 || idx.id_index.count(2) ||
+            !idx.tasks[idx.id_index.at(4)].completed) {
+            std::cerr << "Test 9 failed: Id index tombstones\n";
+            return;
+        }
+        idx.delete_task(1);
+        idx.delete_task(3);
+        if (idx.tasks.size() != 1 || idx.tombstones != 0 || idx.id_index.at(4) != 0) {
+            std::cerr << "Test 9 failed: Tombstone compaction\n";
+            return;
+        }
+    }
+
+    // Test 10: Binary snapshot round trip through mmap
+    {
+        TaskManager bin("test_bin_tasks.json");
+        bin.set_snapshot_format(SnapshotFormat::Binary);
+        bin.clear_tasks();
+        bin.add_task("Mapped task", std::string("2030-01-02"), Priority::High, "Work");
+        bin.add_task("Second mapped task", std::nullopt, Priority::Low, "Home");
+        bin.complete_task(2);
+    }
+    MappedTaskFile mapped("test_bin_tasks.json");
+    TaskManager bin2("test_bin_tasks.json");
+    if (!mapped.is_open() || mapped.size() != 2 || mapped[0].description != "Mapped task" ||
+        !mapped[0].has_due_date() || mapped[1].has_due_date() || !mapped[1].completed || mapped[1].category != "Home" ||
+        bin2.tasks.size() != 2 || bin2.snapshot_format != SnapshotFormat::Binary ||
+        bin2.tasks[0].priority != Priority::High || bin2.next_id != 3) {
+        std::cerr << "Test 10 failed: Binary snapshot\n";
+        return;
+    }
+    {
+        // A description offset that wraps past the heap must not validate
+        std::ifstream in("test_bin_tasks.json", std::ios::binary);
+        std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        const uint64_t wrapping = UINT64_MAX - 1;
+        std::memcpy(&bytes[sizeof(BinaryHeader) + offsetof(BinaryTaskRecord, description_offset)], &wrapping,
+                    sizeof(wrapping));
+        write_whole_file("test_bin_corrupt.json", bytes);
+        if (MappedTaskFile("test_bin_corrupt.json").is_open()) {
+            std::cerr << "Test 10 failed: Wrapping description offset accepted\n";
+            return;
+        }
+    }
+
+    // Test 11: Streaming loader skips unknown keys and rejects incomplete tasks
+    {
+        std::ofstream("test_sax_tasks.json") << R"([{"id": 7, "description": "Streamed", "completed": true,
+            "priority": "High", "category": "Work", "created_at": "2024-01-02 03:04:05",
+            "due_date": null, "tags": [1, {"x": null}], "note": 3.5, "external_ref": 5000000000}])";
+    }
+    TaskManager sax("test_sax_tasks.json");
+    if (sax.tasks.size() != 1 || sax.tasks[0].id != 7 || !sax.tasks[0].completed ||
+        sax.tasks[0].description != "Streamed" || sax.next_id != 8) {
+        std::cerr << "Test 11 failed: Streaming loader\n";
+        return;
+    }
+    {
+        std::ofstream("test_sax_tasks.json") << R"([{"id": 1, "description": "No category"}])";
+    }
+    TaskManager sax2("test_sax_tasks.json");
+    if (!sax2.tasks.empty()) {
+        std::cerr << "Test 11 failed: Streaming loader accepted an incomplete task\n";
+        return;
+    }
+
+    // Test 12: Direct JSON writer matches the DOM serializer
+    {
+        std::vector<Task> sample;
+        sample.emplace_back(1, "Quote \" slash \\ tab\t bell\x07 \xc3\xa9", Priority::High, "Work");
+        sample.emplace_back(2, "Due", Priority::Low, "Home", true);
+        sample.back().due_date = 1700000000;
+        std::string pretty, compact;
+        TaskJsonWriter(pretty, false).write(sample);
+        TaskJsonWriter(compact, true).write(sample);
+        json dom = sample;
+        std::string empty;
+        TaskJsonWriter(empty, false).write(std::vector<Task>{});
+        if (pretty != dom.dump(4) + "\n" || compact != dom.dump() + "\n" || empty != "[]\n") {
+            std::cerr << "Test 12 failed: Direct JSON writer\n";
+            return;
+        }
+    }
+
+    // Test 13: Fixed-layout timestamp parser agrees with date::parse
+    {
+        int64_t secs = 0;
+        const bool ok = parse_fixed_timestamp("2024-02-29 23:59:58", true, secs);
+        std::istringstream iss("2024-02-29 23:59:58");
+        system_clock::time_point expected;
+        iss >> date::parse("%Y-%m-%d %H:%M:%S", expected);
+        if (!ok || system_clock::time_point(seconds(secs)) != expected ||
+            !parse_fixed_timestamp("1969-12-31", false, secs) || secs != -86400 ||
+            parse_fixed_timestamp("2023-02-29 00:00:00", true, secs) ||
+            parse_fixed_timestamp("2024-01-0a 00:00:00", true, secs) ||
+            parse_fixed_timestamp("2024-01-01 00:00:0\xb9", true, secs) ||
+            parse_fixed_timestamp("2024-1-01", false, secs)) {
+            std::cerr << "Test 13 failed: Fixed timestamp parser\n";
+            return;
+        }
+    }
+
+    // Test 14: Cached timestamp formatter agrees with date::format
+    {
+        TimestampFormatter formatter;
+        for (int64_t secs : {int64_t(0), int64_t(-1), int64_t(951782399), int64_t(951782400), int64_t(1709251199)}) {
+            const date::sys_seconds tp{seconds(secs)};
+            if (formatter.format(tp, TimeLayout::Seconds) != date::format("%Y-%m-%d %H:%M:%S", tp) ||
+                formatter.format(tp, TimeLayout::Minutes) != date::format("%Y-%m-%d %H:%M", tp) ||
+                formatter.format(tp, TimeLayout::Date) != date::format("%Y-%m-%d", tp)) {
+                std::cerr << "Test 14 failed: Timestamp formatter\n";
+                return;
+            }
+        }
+    }
+
+    // Test 15: Packed sort keys order like the old comparators, and a
+    // limited listing shows the same window a full sort would
+    {
+        Task early(1, "Early"), late(2, "Late"), none(3, "None");
+        early.due_date = -100;
+        late.due_date = 100;
+        late.priority = Priority::High;
+        if (!(sort_key(view_of(early), SortBy::DueDate) < sort_key(view_of(late), SortBy::DueDate)) ||
+            !(sort_key(view_of(late), SortBy::DueDate) < sort_key(view_of(none), SortBy::DueDate)) ||
+            !(sort_key(view_of(late), SortBy::Priority) < sort_key(view_of(early), SortBy::Priority))) {
+            std::cerr << "Test 15 failed: Sort keys\n";
+            return;
+        }
+
+        // Three priorities and five due dates over 40 rows, so most keys tie
+        std::vector<Task> rows;
+        for (int i = 0; i < 40; i++) {
+            Task task(i + 1, "Row " + std::to_string(i + 1), static_cast<Priority>(i * 7 % 3));
+            if (i % 4) task.due_date = (i * 13 % 5) * 86400;
+            rows.push_back(task);
+        }
+        auto rendered = [&rows](const ListOptions& opts) {
+            std::vector<SortEntry> order;
+            for (uint32_t i = 0; i < rows.size(); i++) order.push_back({0, i});
+            std::ostringstream out;
+            std::streambuf* saved = std::cout.rdbuf(out.rdbuf());
+            render_task_list(order, [&rows](uint32_t i) { return view_of(rows[i]); },
+                             [&rows](uint32_t i, SortBy by) { return sort_key(view_of(rows[i]), by); }, opts);
+            std::cout.rdbuf(saved);
+            std::vector<std::string> listed;  // the task rows, without the header
+            std::istringstream lines(out.str());
+            for (std::string line; std::getline(lines, line);) {
+                if (!line.empty() && std::isdigit(static_cast<unsigned char>(line[0]))) listed.push_back(line);
+            }
+            return listed;
+        };
+        auto window_matches = [&](const ListOptions& opts) {
+            ListOptions all = opts;
+            all.offset = 0;
+            all.limit = SIZE_MAX;
+            const auto full = rendered(all);
+            const size_t begin = std::min(opts.offset, full.size());
+            const size_t end = std::min(opts.limit, full.size() - begin) + begin;
+            return rendered(opts) == std::vector<std::string>(full.begin() + begin, full.begin() + end);
+        };
+        const std::pair<size_t, size_t> windows[] = {{0, 1}, {0, 5}, {3, 10}, {12, 7}, {35, 10}, {39, 1},
+                                                     {40, 5}, {100, 3}, {0, 40}, {0, 39}};
+        for (SortBy by : {SortBy::Id, SortBy::Priority, SortBy::DueDate}) {
+            for (const auto& [offset, limit] : windows) {
+                ListOptions opts;
+                opts.sort_by = by;
+                opts.offset = offset;
+                opts.limit = limit;
+                if (!window_matches(opts)) {
+                    std::cerr << "Test 15 failed: Window " << offset << "+" << limit << " differs from full sort\n";
+                    return;
+                }
+            }
+        }
+
+        // --limit 0 lists everything past the offset
+        auto options = setup_options();
+        const char* args[] = {"TaskManager", "-c", "list", "--sort-by", "priority", "--limit", "0", "--offset", "6"};
+        int argc = 9;
+        const char** argv = args;
+        ListOptions opts;
+        if (!parse_list_options(options.parse(argc, argv), opts) || opts.limit != SIZE_MAX ||
+            !window_matches(opts) || rendered(opts).size() != rows.size() - 6) {
+            std::cerr << "Test 15 failed: --limit 0 should list every remaining task\n";
+            return;
+        }
+    }
+
+    // Test 16: Rename-based save keeps the previous snapshot as .bak
+    {
+        TaskManager saver("test_rename_tasks.json");
+        saver.clear_tasks();
+        saver.add_task("Before", std::nullopt, Priority::Medium, "General");
+        const auto before_size = fs::file_size("test_rename_tasks.json");
+        saver.add_task("After", std::nullopt, Priority::Medium, "General");
+        if (fs::file_size("test_rename_tasks.json.bak") != before_size ||
+            fs::exists("test_rename_tasks.json.tmp") || TaskManager("test_rename_tasks.json").tasks.size() != 2) {
+            std::cerr << "Test 16 failed: Rename-based save\n";
+            return;
+        }
+    }
+
+    // Test 17: Durability levels count the syncs they perform
+    {
+        TaskManager none("test_wal_tasks.json", StorageMode::Wal);
+        none.clear_tasks();
+        none.add_task("Unsynced", std::nullopt, Priority::Medium, "General");
+        TaskManager batch("test_sync_batch.json", StorageMode::Wal);
+        batch.set_durability(Durability::Batch, 3, milliseconds(60000));
+        TaskManager each("test_sync_each.json", StorageMode::Wal);
+        each.set_durability(Durability::Sync);
+        for (int i = 0; i < 7; i++) {
+            batch.add_task("Grouped", std::nullopt, Priority::Medium, "General");
+            each.add_task("Synced", std::nullopt, Priority::Medium, "General");
+        }
+        const size_t grouped = batch.sync_count();
+        batch.sync_pending();
+        if (none.sync_count() != 0 || grouped != 2 || batch.sync_count() != 3 || each.sync_count() != 7) {
+            std::cerr << "Test 17 failed: Durability levels\n";
+            return;
+        }
+    }
+
+    // Test 18: Columnar store drops tombstones and their strings on compaction
+    {
+        TaskStore store;
+        Task due_task(2, "Second", Priority::High, "Work");
+        due_task.due_date = 86400;
+        store.push_back(Task(1, "First", Priority::Low, "Home"));
+        store.push_back(due_task);
+        store.push_back(Task(3, "Third", Priority::Medium, "Home"));
+        store.retire(0);
+        store.set_completed(2);
+        size_t live = 0;
+        for (const TaskView t : store) {
+            live += t.id != 0;
+        }
+        store.compact();
+        if (live != 2 || store.size() != 2 || store[0].description != "Second" || store[0].category != "Work" ||
+            !store[0].has_due_date() || store[1].has_due_date() || !store[1].completed || store[1].description != "Third" ||
+            store.max_id() != 3 || store.sort_key(0, SortBy::Priority) >= store.sort_key(1, SortBy::Priority)) {
+            std::cerr << "Test 18 failed: Columnar store\n";
+            return;
+        }
+    }
+
+    // Test 19: Categories are interned once and stored once in binary snapshots
+    {
+        TaskManager cat("test_bin_tasks.json");
+        cat.set_snapshot_format(SnapshotFormat::Binary);
+        cat.clear_tasks();
+        cat.add_task("One", std::nullopt, Priority::Medium, "Work");
+        cat.add_task("Two", std::nullopt, Priority::Medium, "Home");
+        cat.add_task("Three", std::nullopt, Priority::Medium, "Work");
+        MappedTaskFile interned("test_bin_tasks.json");
+        if (cat.tasks.categories().size() != 2 || cat.tasks.category_id(0) != cat.tasks.category_id(2) ||
+            !interned.is_open() || interned.find_category("Work") != interned.category_id(2) ||
+            interned.category_id(1) == interned.category_id(0) || interned.find_category("Play") ||
+            interned[2].category != "Work") {
+            std::cerr << "Test 19 failed: Category dictionary\n";
+            return;
+        }
+    }
+
+    // Test 20: A presized arena serves a whole load from one upstream allocation
+    {
+        struct CountingResource : std::pmr::memory_resource {
+            size_t allocations = 0;
+            void* do_allocate(size_t bytes, size_t align) override {
+                allocations++;
+                return std::pmr::new_delete_resource()->allocate(bytes, align);
+            }
+            void do_deallocate(void* p, size_t bytes, size_t align) override {
+                std::pmr::new_delete_resource()->deallocate(p, bytes, align);
+            }
+            bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+                return this == &other;
+            }
+        } counting;
+        TaskStore store(&counting);
+        store.reset(TaskStore::arena_bytes_for(1000, 1000 * 16));
+        store.reserve(1000, 1000 * 16);
+        for (int i = 1; i <= 1000; i++) {
+            store.push_back(Task(i, "Arena task " + std::to_string(i), Priority::Low, i % 2 ? "Odd" : "Even"));
+        }
+        const size_t loaded = counting.allocations;
+        for (int i = 1; i <= 1000; i += 2) {
+            store.retire(static_cast<size_t>(i - 1));
+        }
+        store.compact();
+        if (loaded != 1 || counting.allocations != 2 || store.size() != 500 || store[0].description != "Arena task 2") {
+            std::cerr << "Test 20 failed: Arena allocation\n";
+            return;
+        }
+    }
+
+    // Test 21: Due-date index follows mutations and answers range queries in due order
+    {
+        TaskManager due("test_wal_tasks.json", StorageMode::Wal);
+        due.clear_tasks();
+        due.add_task("March", std::string("2030-03-01"), Priority::Medium, "General");
+        due.add_task("January", std::string("2030-01-01"), Priority::Medium, "General");
+        due.add_task("Undated", std::nullopt, Priority::Medium, "General");
+        due.add_task("February", std::string("2030-02-01"), Priority::Medium, "General");
+        due.add_task("Gone", std::string("2030-01-15"), Priority::Medium, "General");
+        due.delete_task(5);
+        due.complete_task(2);
+
+        ListOptions range;
+        range.due_until = 1896134400;  // 2030-02-01
+        range.sort_by = SortBy::DueDate;
+        bool presorted = false;
+        const auto before_feb = due.run_plan(due.plan_query(range), range, presorted);
+        ListOptions overdue = range;
+        overdue.completed = false;
+        ListOptions by_due;
+        by_due.sort_by = SortBy::DueDate;
+        bool all_presorted = false;
+        const auto all = due.run_plan(due.plan_query(by_due), by_due, all_presorted);
+        bool overdue_presorted = false;
+        const auto none_overdue = due.run_plan(due.plan_query(overdue), overdue, overdue_presorted);
+        TaskManager reloaded("test_wal_tasks.json", StorageMode::Wal);
+        if (due.due_index.size() != 3 || before_feb.size() != 1 || !presorted ||
+            due.tasks[before_feb[0].index].id != 2 || !none_overdue.empty() ||
+            all.size() != 4 || !all_presorted || due.tasks[all[0].index].id != 2 ||
+            due.tasks[all[2].index].id != 1 || due.tasks[all[3].index].id != 3 ||
+            reloaded.due_index != due.due_index) {
+            std::cerr << "Test 21 failed: Due-date index\n";
+            return;
+        }
+    }
+
+    // Test 22: Inverted index answers AND queries and survives a reload from its sidecar
+    {
+        PostingList list;
+        for (int id = 3; id <= 3000; id += 3) {
+            list.append(id);
+        }
+        PostingList::Cursor cursor(list);
+        if (list.size() != 1000 || !cursor.seek(1500) || cursor.value() != 1500 || !cursor.seek(1501) ||
+            cursor.value() != 1503 || cursor.seek(3001)) {
+            std::cerr << "Test 22 failed: Posting list skips\n";
+            return;
+        }
+
+        {
+            TaskManager text("test_search_tasks.json");
+            text.clear_tasks();
+            text.add_task("Fix login bug in API", std::nullopt, Priority::High, "Work");
+            text.add_task("Write API docs", std::nullopt, Priority::Low, "Work");
+            text.add_task("Buy milk", std::nullopt, Priority::Low, "Home");
+            text.add_task("api login timeout", std::nullopt, Priority::Medium, "Work");
+            text.delete_task(4);
+            if (text.search_index.search("api") != std::vector<int>{1, 2} ||
+                text.search_index.search("LOGIN api") != std::vector<int>{1} ||
+                !text.search_index.search("api milk").empty() || !text.search_index.search("nope").empty()) {
+                std::cerr << "Test 22 failed: Inverted index search\n";
+                return;
+            }
+        }
+        TaskManager reloaded("test_search_tasks.json");
+        std::ifstream sidecar("test_search_tasks.json.idx", std::ios::binary);
+        const std::string data((std::istreambuf_iterator<char>(sidecar)), std::istreambuf_iterator<char>());
+        InvertedIndex persisted;
+        if (!persisted.decode(data, *snapshot_stamp("test_search_tasks.json")) ||
+            persisted.search("login") != std::vector<int>{1} || persisted.term_count() != 9 ||
+            reloaded.search_index.search("api docs") != std::vector<int>{2}) {
+            std::cerr << "Test 22 failed: Persisted search index\n";
+            return;
+        }
+    }
+
+    // Test 23: Trigram index narrows substring candidates and follows deletes
+    {
+        TrigramIndex grams;
+        grams.add(1, "TICKET-1234 fix crash");
+        grams.add(2, "TICKET-1299 abcXbcd");
+        grams.add(3, "unrelated");
+        if (grams.candidates("ET-12") != std::vector<int>{1, 2} || grams.candidates("1234") != std::vector<int>{1} ||
+            grams.candidates("abcd") != std::vector<int>{2} || grams.candidates("zzz") != std::vector<int>{} ||
+            grams.candidates("12")) {
+            std::cerr << "Test 23 failed: Trigram candidates\n";
+            return;
+        }
+
+        TaskManager sub("test_search_tasks.json");
+        sub.clear_tasks();
+        sub.add_task("OPS-4411 rotate keys", std::nullopt, Priority::Medium, "Work");
+        sub.add_task("OPS-4412 renew certs", std::nullopt, Priority::Medium, "Work");
+        const auto before = sub.substring_candidates("OPS-441");
+        sub.delete_task(1);
+        sub.add_task("OPS-4413 audit", std::nullopt, Priority::Medium, "Work");
+        if (!before || before->size() != 2 || sub.substring_candidates("OPS-441") != std::vector<int>{2, 3}) {
+            std::cerr << "Test 23 failed: Trigram index maintenance\n";
+            return;
+        }
+    }
+
+    // Test 24: Roaring bitmaps agree with std::set across array and bitmap containers
+    {
+        RoaringBitmap a, b;
+        std::set<uint32_t> sa, sb;
+        uint32_t seed = 7;
+        for (int i = 0; i < 30000; i++) {
+            seed = seed * 1103515245 + 12345;
+            const uint32_t x = (seed >> 4) % 140000;  // dense enough for bitmap containers
+            a.add(x);
+            sa.insert(x);
+            if (i % 3 == 0) {
+                const uint32_t y = (seed >> 7) % 200000;  // sparse: array containers
+                b.add(y);
+                sb.insert(y);
+            }
+        }
+        for (uint32_t x = 0; x < 140000; x += 5) {
+            a.remove(x);
+            sa.erase(x);
+        }
+        auto members = [](const RoaringBitmap& bitmap) {
+            std::vector<uint32_t> out;
+            bitmap.for_each([&out](uint32_t x) { out.push_back(x); });
+            return out;
+        };
+        std::vector<uint32_t> both, either, only_a;
+        std::set_intersection(sa.begin(), sa.end(), sb.begin(), sb.end(), std::back_inserter(both));
+        std::set_union(sa.begin(), sa.end(), sb.begin(), sb.end(), std::back_inserter(either));
+        std::set_difference(sa.begin(), sa.end(), sb.begin(), sb.end(), std::back_inserter(only_a));
+        if (members(a) != std::vector<uint32_t>(sa.begin(), sa.end()) || a.cardinality() != sa.size() ||
+            members(a & b) != both || members(a | b) != either || members(RoaringBitmap::and_not(a, b)) != only_a ||
+            members(a & a) != members(a) || !RoaringBitmap::and_not(a, a).empty()) {
+            std::cerr << "Test 24 failed: Roaring bitmap operations\n";
+            return;
+        }
+
+        TaskManager flags("test_search_tasks.json");
+        flags.clear_tasks();
+        flags.add_task("High work", std::nullopt, Priority::High, "Work");
+        flags.add_task("High home", std::nullopt, Priority::High, "Home");
+        flags.add_task("Done high work", std::nullopt, Priority::High, "Work");
+        flags.add_task("Low work", std::nullopt, Priority::Low, "Work");
+        flags.add_task("Deleted high work", std::nullopt, Priority::High, "Work");
+        flags.complete_task(3);
+        flags.delete_task(5);
+        ListOptions pending_high_work;
+        pending_high_work.category = "Work";
+        pending_high_work.priority = Priority::High;
+        pending_high_work.completed = false;
+        ListOptions done;
+        done.completed = true;
+        bool presorted = false;
+        const auto hits = flags.run_plan(flags.plan_query(pending_high_work), pending_high_work, presorted);
+        const auto done_hits = flags.run_plan(flags.plan_query(done), done, presorted);
+        if (hits.size() != 1 || flags.tasks[hits[0].index].id != 1 || done_hits.size() != 1 ||
+            flags.tasks[done_hits[0].index].id != 3 || flags.tasks.live().cardinality() != 4) {
+            std::cerr << "Test 24 failed: Bitmap filtered listing\n";
+            return;
+        }
+    }
+
+    // Test 25: --where expressions fold at parse time and every evaluation path agrees
+    {
+        std::string error;
+        auto root_kind = [&error](const char* text) {
+            auto expr = FilterExpr::parse(text, error);
+            return expr ? std::make_optional(expr->node(expr->root())) : std::nullopt;
+        };
+        const auto always = root_kind("priority>=low && (completed || pending)");
+        const auto never = root_kind("completed && !completed || category in (A) && category==B");
+        const auto medium = root_kind("priority>=medium && not priority==high");
+        const auto window = root_kind("due>=2026-01-01 && due<2026-03-01 && due>2026-01-31");
+        const auto pending = root_kind("!!!completed");
+        if (!always || always->kind != FilterExpr::Kind::Const || !always->value ||
+            !never || never->kind != FilterExpr::Kind::Const || never->value ||
+            !medium || medium->kind != FilterExpr::Kind::Priority || medium->priorities != 0b010 ||
+            !window || window->kind != FilterExpr::Kind::Due || window->hi - window->lo != 28 * 86400 ||
+            !pending || pending->kind != FilterExpr::Kind::Completed || pending->value ||
+            FilterExpr::parse("priority==urgent", error) || FilterExpr::parse("(id>1", error) ||
+            FilterExpr::parse("due<2026-02-30", error) || FilterExpr::parse("", error)) {
+            std::cerr << "Test 25 failed: Expression parsing and folding\n";
+            return;
+        }
+
+        TaskManager where("test_search_tasks.json");
+        where.clear_tasks();
+        const char* categories[] = {"Work", "Ops", "Home"};
+        for (int i = 0; i < 300; i++) {
+            char due[11];
+            std::snprintf(due, sizeof(due), "2026-%02d-%02d", 10 + i % 2, 1 + i % 28);
+            where.add_task("Task", i % 4 ? std::make_optional<std::string>(due) : std::nullopt,
+                           static_cast<Priority>(i % 3), categories[i % 7 % 3]);
+            if (i % 5 == 0) where.complete_task(i + 1);
+        }
+        for (int id = 10; id < 300; id += 13) where.delete_task(id);
+        const char* queries[] = {
+            "priority>=medium && !completed && category in (Work,Ops) && due<2026-11-01",
+            "id>250 || due==none",                   // no index for the id range: column scan
+            "!(category==Home) && id>=100 && id<120",  // id probes
+            "due!=2026-10-05 && priority!=low",
+            "category in (Nowhere) || completed",
+        };
+        for (const char* text : queries) {
+            ListOptions opts;
+            opts.where = FilterExpr::parse(text, error);
+            bool presorted = false;
+            std::vector<int> got, expected;
+            for (const auto& entry : where.run_plan(where.plan_query(opts), opts, presorted)) {
+                got.push_back(where.tasks.id(entry.index));
+            }
+            for (const TaskView t : where.tasks) {
+                if (opts.where && opts.where->matches(t)) expected.push_back(t.id);
+            }
+            std::vector<int> scanned;
+            if (opts.where) {
+                where.tasks.scan(*opts.where).for_each([&](uint32_t slot) { scanned.push_back(where.tasks.id(slot)); });
+            }
+            if (!opts.where || got != expected || scanned != expected || expected.empty()) {
+                std::cerr << "Test 25 failed: --where results for " << text << "\n";
+                return;
+            }
+        }
+    }
+
+    // Test 26: Column statistics follow mutations and the planner picks the cheap access path
+    {
+        TaskManager planned("test_search_tasks.json");
+        planned.clear_tasks();
+        for (int i = 0; i < 400; i++) {
+            char due[11];
+            std::snprintf(due, sizeof(due), "2026-%02d-%02d", 10 + i % 2, 1 + i % 28);
+            planned.add_task("Task", i % 4 ? std::make_optional<std::string>(due) : std::nullopt,
+                             static_cast<Priority>(i % 3), i % 50 ? "Work" : "Rare");
+            if (i % 5 == 0) planned.complete_task(i + 1);
+        }
+        for (int id = 10; id < 400; id += 13) planned.delete_task(id);
+        planned.complete_task(11);
+        planned.complete_task(11);
+        planned.compact_slots();
+
+        size_t live = 0, done = 0, undated = 0, rare = 0;
+        std::array<size_t, 3> priorities{};
+        for (const TaskView t : planned.tasks) {
+            live++;
+            done += t.completed;
+            undated += !t.has_due_date();
+            rare += t.category == "Rare";
+            priorities[static_cast<size_t>(t.priority)]++;
+        }
+        const auto& st = planned.tasks.stats();
+        const auto rare_id = planned.tasks.categories().find("Rare");
+        if (st.live != live || st.done != done || st.undated != undated || st.priority != priorities ||
+            !rare_id || st.category[*rare_id] != rare ||
+            std::abs(st.due_between(INT64_MIN + 1, INT64_MAX) - static_cast<double>(live - undated)) > 1e-6) {
+            std::cerr << "Test 26 failed: Column statistics\n";
+            return;
+        }
+
+        auto plan_for = [&planned](const char* text) {
+            std::string error;
+            ListOptions opts;
+            opts.where = FilterExpr::parse(text, error);
+            return planned.plan_query(opts);
+        };
+        const auto by_category = plan_for("category==Rare && priority==high");
+        const auto by_due = plan_for("due==2026-10-05 && priority!=low");
+        const auto by_id = plan_for("id>=100 && id<103 && !completed");
+        const auto scanned = plan_for("id>3");
+        if (by_category.access != QueryPlan::Access::Bitmaps || by_category.answered.size() != 2 ||
+            by_due.access != QueryPlan::Access::DueIndex || by_due.residual.size() != 1 ||
+            by_id.access != QueryPlan::Access::IdIndex || scanned.access != QueryPlan::Access::Scan ||
+            by_category.considered.size() != 2 || std::abs(by_id.estimated_rows - 3 * 0.8 * live / 400) > 1) {
+            std::cerr << "Test 26 failed: Access path choice\n";
+            return;
+        }
+    }
+
+    // Test 27: Shared locks admit each other, an exclusive lock admits nobody,
+    // and destroying the holder releases it
+    {
+        const std::string path = "test_lock.json.lock";
+        // flock locks belong to the open file, so a second open() contends
+        // like another process would; LOCK_NB reports instead of blocking
+        auto can_lock = [&path](int op) {
+            const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+            const bool granted = fd >= 0 && ::flock(fd, op | LOCK_NB) == 0;
+            if (fd >= 0) ::close(fd);
+            return granted;
+        };
+        bool shared_ok, exclusive_ok, released_ok;
+        {
+            FileLock first, second;
+            shared_ok = first.acquire(path, LockMode::Shared) && can_lock(LOCK_SH) && !can_lock(LOCK_EX) &&
+                        second.acquire(path, LockMode::Shared);
+            first.release();
+            shared_ok = shared_ok && !can_lock(LOCK_EX);  // second still holds it
+        }
+        {
+            FileLock writer;
+            exclusive_ok = writer.acquire(path, LockMode::Exclusive) && !can_lock(LOCK_SH) && !can_lock(LOCK_EX);
+        }
+        released_ok = can_lock(LOCK_EX);
+        FileLock none;
+        released_ok = released_ok && none.acquire(path, LockMode::None) && can_lock(LOCK_EX);
+        fs::remove(path);
+        if (!shared_ok || !exclusive_ok || !released_ok) {
+            std::cerr << "Test 27 failed: File lock modes (shared " << shared_ok << ", exclusive " << exclusive_ok
+                      << ", released " << released_ok << ")\n";
+            return;
+        }
+    }
+
+    // Test 28: The daemon runs forwarded commands and batches, and per-request
+    // --format/--compact do not stick to the resident manager
+    {
+        const std::string file = "test_daemon_tasks.json";
+        for (const char* suffix : {"", ".bak", ".idx"}) {
+            fs::remove(file + suffix);
+        }
+        TaskManager manager(file);
+        struct Reply {
+            bool ok;
+            int32_t code;
+            std::string out, err;
+        };
+        auto exchange = [&manager](const std::vector<std::string>& args) {
+            int fds[2];
+            Reply reply{false, -1, "", ""};
+            if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0) {
+                return reply;
+            }
+            std::string request;
+            const uint32_t count = static_cast<uint32_t>(args.size());
+            request.append(reinterpret_cast<const char*>(&count), sizeof(count));
+            for (const auto& arg : args) {
+                put_string(request, arg);
+            }
+            if (write_all(fds[0], request.data(), request.size())) {
+                handle_daemon_client(fds[1], manager);
+                ::close(fds[1]);
+                reply.ok = read_all(fds[0], &reply.code, sizeof(reply.code)) && read_string(fds[0], reply.out) &&
+                           read_string(fds[0], reply.err);
+            } else {
+                ::close(fds[1]);
+            }
+            ::close(fds[0]);
+            return reply;
+        };
+
+        const auto added = exchange({"-c", "add", "-d", "Forwarded", "--format", "binary", "--compact"});
+        const bool written_binary = MappedTaskFile::is_binary(file);
+        const bool restored = manager.format() == SnapshotFormat::Json && !manager.compacts_json();
+        const auto plain = exchange({"-c", "add", "-d", "Plain"});
+        if (!added.ok || added.code != 0 || added.out.find("Task added with ID 1") == std::string::npos ||
+            !written_binary || !restored || !plain.ok || plain.code != 0 || MappedTaskFile::is_binary(file)) {
+            std::cerr << "Test 28 failed: Forwarded command options\n";
+            return;
+        }
+
+        const auto batch = exchange({kDaemonBatchRequest, "7", "-c add -d Third\n# comment\n-c nosuch\n"});
+        if (!batch.ok || batch.code != 1 || batch.out.find("Task added with ID 3") == std::string::npos ||
+            batch.err.find("nosuch") == std::string::npos || manager.tasks.stats().live != 3) {
+            std::cerr << "Test 28 failed: Forwarded batch\n";
+            return;
+        }
+
+        // An oversized argument count is dropped without a reply
+        const auto oversized = exchange(std::vector<std::string>(kMaxDaemonArgs + 1, "-c"));
+        if (oversized.ok || manager.tasks.stats().live != 3) {
+            std::cerr << "Test 28 failed: Oversized request\n";
+            return;
+        }
+    }
+
+    std::cout << "All tests passed.\n";
+}
+
+// Substring search benchmark: trigram candidates plus an exact verify versus
+// std::string::find over every description. The corpus is built from
+// wordlist.txt with ticket-style prefixes.
+void run_benchmarks() {
+    std::ifstream wordlist("wordlist.txt");
+    std::vector<std::string> words;
+    for (std::string word; std::getline(wordlist, word);) {
+        if (!word.empty()) words.push_back(word);
+    }
+    if (words.empty()) {
+        std::cerr << "Benchmark needs wordlist.txt in the working directory.\n";
+        return;
+    }
+
+    constexpr int kTasks = 200000;
+    std::vector<std::string> descriptions;
+    descriptions.reserve(kTasks);
+    uint32_t seed = 12345;
+    auto next_word = [&]() -> const std::string& {
+        seed = seed * 1103515245 + 12345;
+        return words[(seed >> 8) % words.size()];
+    };
+    for (int i = 0; i < kTasks; i++) {
+        std::string desc = "TICKET-" + std::to_string(100000 + i);
+        for (int w = 0; w < 5; w++) {
+            desc += ' ';
+            desc += next_word();
+        }
+        descriptions.push_back(std::move(desc));
+    }
+
+    auto start = steady_clock::now();
+    TrigramIndex index;
+    for (int i = 0; i < kTasks; i++) {
+        index.add(i + 1, descriptions[static_cast<size_t>(i)]);
+    }
+    const auto build_ms = duration_cast<milliseconds>(steady_clock::now() - start).count();
+    std::cout << "Indexed " << kTasks << " descriptions (" << index.trigram_count() << " trigrams) in "
+              << build_ms << " ms\n\n";
+    std::cout << std::left << std::setw(16) << "Pattern" << std::setw(10) << "Matches" << std::setw(12) << "Candidates"
+              << std::setw(12) << "Scan (us)" << std::setw(12) << "Index (us)" << "\n";
+
+    constexpr int kRepeats = 5;
+    for (const std::string pattern : {"TICKET-123456", "-2999", "abc", "tion", "ology", "hotel", "zz"}) {
+        size_t scan_hits = 0;
+        start = steady_clock::now();
+        for (int r = 0; r < kRepeats; r++) {
+            scan_hits = 0;
+            for (const auto& desc : descriptions) {
+                scan_hits += desc.find(pattern) != std::string::npos;
+            }
+        }
+        const auto scan_us = duration_cast<microseconds>(steady_clock::now() - start).count() / kRepeats;
+
+        size_t index_hits = 0;
+        size_t candidate_count = 0;
+        start = steady_clock::now();
+        for (int r = 0; r < kRepeats; r++) {
+            index_hits = 0;
+            const auto candidates = index.candidates(pattern);
+            if (!candidates) {
+                // Too short to narrow: the index degrades to the same scan
+                candidate_count = descriptions.size();
+                for (const auto& desc : descriptions) {
+                    index_hits += desc.find(pattern) != std::string::npos;
+                }
+                continue;
+            }
+            candidate_count = candidates->size();
+            for (int id : *candidates) {
+                index_hits += descriptions[static_cast<size_t>(id - 1)].find(pattern) != std::string::npos;
+            }
+        }
+        const auto index_us = duration_cast<microseconds>(steady_clock::now() - start).count() / kRepeats;
+
+        if (scan_hits != index_hits) {
+            std::cerr << "Benchmark mismatch for '" << pattern << "': " << scan_hits << " vs " << index_hits << "\n";
+            return;
+        }
+        std::cout << std::setw(16) << pattern << std::setw(10) << scan_hits << std::setw(12) << candidate_count
+                  << std::setw(12) << scan_us << std::setw(12) << index_us << "\n";
+    }
 }